@@ -5,12 +5,291 @@
 #include <time.h>
 #include <algorithm>
 #include <string>
+#include <sstream>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <random>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 #include "long_alg.h"
 
 using namespace std;
 
-const int BigInt::BASE_LEN = 3;
-const int BigInt::BASE = 1000;
+const int BigInt::LIMB_BITS = 64;
+const int BigInt::DEC_BASE_LEN = 19;
+const limb_t BigInt::DEC_BASE = 10000000000000000000ULL;
+
+// limb helpers
+
+// x = x * m + a, grows x if needed
+static void mulAddWord(LimbVector& x, limb_t m, limb_t a) {
+	limb_t carry = a;
+	for (int i = 0; i < (int)x.size(); i++) {
+		dlimb_t cur = (dlimb_t)x[i] * m + carry;
+		x[i] = (limb_t)cur;
+		carry = (limb_t)(cur >> 64);
+	}
+	if (carry)
+		x.push_back(carry);
+}
+
+// x = x / d, returns x % d
+static limb_t divModWord(LimbVector& x, limb_t d) {
+	dlimb_t rem = 0;
+	for (int i = (int)x.size() - 1; i >= 0; i--) {
+		dlimb_t cur = (rem << 64) | x[i];
+		x[i] = (limb_t)(cur / d);
+		rem = cur % d;
+	}
+	return (limb_t)rem;
+}
+
+static int compareAbs(const LimbVector& a, const LimbVector& b) {
+	if (a.size() != b.size())
+		return a.size() > b.size() ? 1 : -1;
+	for (int i = (int)a.size() - 1; i >= 0; i--) {
+		if (a[i] != b[i])
+			return a[i] > b[i] ? 1 : -1;
+	}
+	return 0;
+}
+
+static vector<limb_t> addAbs(const vector<limb_t>& a, const vector<limb_t>& b) {
+	const vector<limb_t>& longer = a.size() >= b.size() ? a : b;
+	const vector<limb_t>& shorter = a.size() >= b.size() ? b : a;
+	vector<limb_t> res(longer.size() + 1, 0);
+	limb_t carry = 0;
+	for (int i = 0; i < (int)longer.size(); i++) {
+		dlimb_t cur = (dlimb_t)longer[i] + (i < (int)shorter.size() ? shorter[i] : 0) + carry;
+		res[i] = (limb_t)cur;
+		carry = (limb_t)(cur >> 64);
+	}
+	res[longer.size()] = carry;
+	return res;
+}
+
+// a - b - borrow on one limb, borrow is updated in place
+static limb_t subBorrow(limb_t a, limb_t b, limb_t& borrow) {
+	limb_t diff = a - b;
+	limb_t borrowOut = a < b;
+	limb_t res = diff - borrow;
+	borrowOut |= diff < borrow;
+	borrow = borrowOut;
+	return res;
+}
+
+// a += b on magnitudes, a may be b itself
+static void addAbsInPlace(LimbVector& a, const LimbVector& b) {
+	if (a.size() < b.size())
+		a.resize(b.size(), 0);
+	limb_t carry = 0;
+	int i = 0;
+	for (; i < (int)b.size(); i++) {
+		dlimb_t cur = (dlimb_t)a[i] + b[i] + carry;
+		a[i] = (limb_t)cur;
+		carry = (limb_t)(cur >> 64);
+	}
+	for (; carry && i < (int)a.size(); i++) {
+		a[i] += 1;
+		carry = a[i] == 0;
+	}
+	if (carry)
+		a.push_back(1);
+}
+
+// a -= b in place, requires a >= b; shared by BigInt digits and the kernels' vectors
+template <typename V>
+static void subAbsInPlace(V& a, const V& b) {
+	limb_t borrow = 0;
+	for (int i = 0; i < (int)a.size() && (i < (int)b.size() || borrow); i++)
+		a[i] = subBorrow(a[i], i < (int)b.size() ? b[i] : 0, borrow);
+}
+
+// a = b - a in place, requires b >= a
+static void subAbsReversed(LimbVector& a, const LimbVector& b) {
+	a.resize(b.size(), 0);
+	limb_t borrow = 0;
+	for (int i = 0; i < (int)b.size(); i++)
+		a[i] = subBorrow(b[i], a[i], borrow);
+}
+
+static void shiftLeftInPlace(LimbVector& a, int shift) {
+	int limbs = shift / 64, bits = shift % 64;
+	if (bits) {
+		limb_t carry = 0;
+		for (int i = 0; i < (int)a.size(); i++) {
+			limb_t next = a[i] >> (64 - bits);
+			a[i] = (a[i] << bits) | carry;
+			carry = next;
+		}
+		if (carry)
+			a.push_back(carry);
+	}
+	if (limbs)
+		a.insert(a.begin(), limbs, 0);
+}
+
+static void shiftRightInPlace(LimbVector& a, int shift) {
+	int limbs = shift / 64, bits = shift % 64;
+	if (limbs >= (int)a.size()) {
+		a.assign(1, 0);
+		return;
+	}
+	a.erase(a.begin(), a.begin() + limbs);
+	if (bits) {
+		for (int i = 0; i < (int)a.size(); i++)
+			a[i] = (a[i] >> bits) | (i + 1 < (int)a.size() ? a[i + 1] << (64 - bits) : 0);
+	}
+	while (a.size() > 1 && a.back() == 0)
+		a.pop_back();
+}
+
+// schoolbook long division (Knuth, TAOCP vol. 2, 4.3.1, Algorithm D)
+static void divModAbs(const LimbVector& a, const LimbVector& b, LimbVector& q, LimbVector& r) {
+	if (compareAbs(a, b) < 0) {
+		q.assign(1, 0);
+		r = a;
+		return;
+	}
+	if (b.size() == 1) {
+		q = a;
+		r.assign(1, divModWord(q, b[0]));
+		while (q.size() > 1 && q.back() == 0)
+			q.pop_back();
+		return;
+	}
+
+	int n = (int)b.size(), m = (int)a.size() - n;
+	int shift = __builtin_clzll(b.back());
+
+	// normalize so that the top limb of the divisor has its high bit set
+	LimbVector v(n), u(a.size() + 1);
+	for (int i = n - 1; i >= 0; i--)
+		v[i] = (b[i] << shift) | (shift && i ? b[i - 1] >> (64 - shift) : 0);
+	u[a.size()] = shift ? a.back() >> (64 - shift) : 0;
+	for (int i = (int)a.size() - 1; i >= 0; i--)
+		u[i] = (a[i] << shift) | (shift && i ? a[i - 1] >> (64 - shift) : 0);
+
+	q.assign(m + 1, 0);
+	for (int j = m; j >= 0; j--) {
+		// estimate the quotient limb from the top two limbs, off by at most 2
+		dlimb_t num = ((dlimb_t)u[j + n] << 64) | u[j + n - 1];
+		dlimb_t qhat = num / v[n - 1];
+		dlimb_t rhat = num % v[n - 1];
+		while ((qhat >> 64) || qhat * v[n - 2] > ((rhat << 64) | u[j + n - 2])) {
+			qhat--;
+			rhat += v[n - 1];
+			if (rhat >> 64)
+				break;
+		}
+
+		// u[j..j+n] -= qhat * v
+		limb_t borrow = 0, carry = 0;
+		for (int i = 0; i < n; i++) {
+			dlimb_t p = qhat * v[i] + carry;
+			carry = (limb_t)(p >> 64);
+			u[i + j] = subBorrow(u[i + j], (limb_t)p, borrow);
+		}
+		u[j + n] = subBorrow(u[j + n], carry, borrow);
+
+		// the estimate was one too large, add the divisor back
+		if (borrow) {
+			qhat--;
+			limb_t c = 0;
+			for (int i = 0; i < n; i++) {
+				dlimb_t s = (dlimb_t)u[i + j] + v[i] + c;
+				u[i + j] = (limb_t)s;
+				c = (limb_t)(s >> 64);
+			}
+			u[j + n] += c;
+		}
+		q[j] = (limb_t)qhat;
+	}
+	while (q.size() > 1 && q.back() == 0)
+		q.pop_back();
+
+	r.resize(n);
+	for (int i = 0; i < n; i++)
+		r[i] = (u[i] >> shift) | (shift ? u[i + 1] << (64 - shift) : 0);
+	while (r.size() > 1 && r.back() == 0)
+		r.pop_back();
+}
+
+static int bitLengthAbs(const LimbVector& a) {
+	int top = (int)a.size() - 1;
+	while (top > 0 && a[top] == 0)
+		top--;
+	return a[top] ? top * 64 + 64 - __builtin_clzll(a[top]) : 0;
+}
+
+static int bitAt(const LimbVector& a, int i) {
+	return (int)((a[i / 64] >> (i % 64)) & 1);
+}
+
+// window width for sliding-window exponentiation, chosen so that the table of
+// 2^(k-1) odd powers pays for itself against the expected number of multiplies
+static int windowSize(int bits) {
+	static const int thresholds[] = { 7, 36, 140, 450, 1303, 3529 };
+	int k = 1;
+	while (k <= 6 && bits > thresholds[k - 1])
+		k++;
+	return k;
+}
+
+// left-to-right sliding-window exponentiation: base^e with mul(acc, x) doing
+// acc = acc * x and sqr(acc) doing acc = acc * acc; e must be non-zero
+template <typename T, typename Mul, typename Sqr>
+static T slidingWindowPow(const T& base, const LimbVector& e, Mul mul, Sqr sqr) {
+	int bits = bitLengthAbs(e);
+	int k = windowSize(bits);
+
+	// odd powers base^1, base^3, ..., base^(2^k - 1)
+	vector<T> table(1, base);
+	if (k > 1) {
+		T base2 = base;
+		sqr(base2);
+		for (int i = 1; i < (1 << (k - 1)); i++) {
+			table.push_back(table[i - 1]);
+			mul(table[i], base2);
+		}
+	}
+
+	T acc = base;
+	bool started = false;
+	for (int i = bits - 1; i >= 0; ) {
+		if (!bitAt(e, i)) {
+			sqr(acc);
+			i--;
+			continue;
+		}
+		// longest window e[i..j] of at most k bits that ends in a set bit
+		int j = max(i - k + 1, 0);
+		while (!bitAt(e, j))
+			j++;
+		int value = 0;
+		for (int b = i; b >= j; b--)
+			value = (value << 1) | bitAt(e, b);
+
+		if (started) {
+			for (int b = i; b >= j; b--)
+				sqr(acc);
+			mul(acc, table[value >> 1]);
+		}
+		else {
+			acc = table[value >> 1];
+			started = true;
+		}
+		i = j - 1;
+	}
+	return acc;
+}
 
 // initialization
 
@@ -20,55 +299,54 @@ BigInt::BigInt() {
 	digits.resize(1, 0);
 }
 
-BigInt::BigInt(string str) {
+BigInt::BigInt(const string& str) {
 	digits.clear();
-	if (str[0] == '-') {
+	int start = 0;
+	if (!str.empty() && str[0] == '-') {
 		isNegative = true;
-		str.erase(str.begin());
+		start = 1;
 	}
 	else
 		isNegative = false;
 
-	for (int i = 0; i < (int)str.size(); i++) {
+	if ((int)str.size() == start)
+		throw "Value Error";
+	for (int i = start; i < (int)str.size(); i++) {
 		if (!isDigit(str[i]))
 			throw "Value Error";
 	}
 
-	for (int i = (int)str.length(); i > 0; i -= BASE_LEN) {
-		if (i < BASE_LEN)
-			digits.push_back(atoi(str.substr(0, i).c_str()));
-		else
-			digits.push_back(atoi(str.substr(i - BASE_LEN, BASE_LEN).c_str()));
-	}
+	bool negative = isNegative;
+	*this = parseDecimal(str.data() + start, (int)str.size() - start);
+	isNegative = negative;
+	clearNumber();
+}
 
-	removeLeadingZeros();
+BigInt BigInt::fromWord(limb_t mag, bool negative) {
+	BigInt res;
+	res.digits[0] = mag;
+	res.isNegative = negative && mag != 0;
+	return res;
 }
 
-BigInt::BigInt(int x) {
-	digits.clear();
-	if (x < 0) {
-		isNegative = true;
-		x = -x;
-	}
-	else {
-		isNegative = false;
-	}
+BigInt::BigInt(vector<limb_t>digits_, bool isNegative_) {
+	digits.assign(digits_.data(), digits_.data() + digits_.size());
+	isNegative = isNegative_;
+	removeLeadingZeros();
+}
 
-	if (x == 0) {
+BigInt::BigInt(LimbVector&& digits_, bool isNegative_) : isNegative(isNegative_), digits(move(digits_)) {
+	if (digits.empty())
 		digits.push_back(0);
-	}
-	else {
-		while (x != 0) {
-			digits.push_back(x % BASE);
-			x /= BASE;
-		}
-	}
+	clearNumber();
 }
 
-BigInt::BigInt(vector<int>digits_, bool isNegative_) {
-	digits = digits_;
-	isNegative = isNegative_;
-	removeLeadingZeros();
+BigInt::BigInt(const BigIntView& view) {
+	digits.assign(view.data(), view.data() + view.size());
+	if (digits.empty())
+		digits.push_back(0);
+	isNegative = view.isNegative();
+	clearNumber();
 }
 
 BigInt::BigInt(const BigInt& bigInt) {
@@ -76,11 +354,37 @@ BigInt::BigInt(const BigInt& bigInt) {
 	isNegative = bigInt.isNegative;
 }
 
+BigInt::BigInt(BigInt&& bigInt) noexcept {
+	digits = move(bigInt.digits);
+	isNegative = bigInt.isNegative;
+	bigInt.digits.assign(1, 0);
+	bigInt.isNegative = false;
+}
+
+BigInt& BigInt::operator = (const BigInt& bigInt) {
+	digits = bigInt.digits;
+	isNegative = bigInt.isNegative;
+	return *this;
+}
+
+// the moved-from value is left as a valid zero
+BigInt& BigInt::operator = (BigInt&& bigInt) noexcept {
+	if (this != &bigInt) {
+		digits.swap(bigInt.digits);
+		isNegative = bigInt.isNegative;
+		bigInt.digits.assign(1, 0);
+		bigInt.isNegative = false;
+	}
+	return *this;
+}
+
 // functions - helpers
 
 void BigInt::removeLeadingZeros() {
 	while (digits.size() > 1 && digits.back() == 0)
 		digits.pop_back();
+	if (digits.empty())
+		digits.push_back(0);
 }
 
 void BigInt::clearNumber() {
@@ -89,344 +393,1142 @@ void BigInt::clearNumber() {
 		isNegative = false;
 }
 
-BigInt BigInt::abs(){
-	BigInt res = BigInt(digits, false);
+BigInt BigInt::abs() const {
+	BigInt res(*this);
+	res.isNegative = false;
 	return res;
 }
 
-string BigInt::formatOutput(int x) {
-	string s;
-	s.clear();
-	if (x == 0) {
-		s = "0";
-	}
-	else {
-		while (x != 0) {
-			s = (char)('0' + x % 10) + s;
-			x /= 10;
-		}
-	}
-	while ((int)s.size() < BASE_LEN) {
-		s = '0' + s;
-	}
-	return s;
-}
-
 bool BigInt::isDigit(char ch) {
 	return ch >= '0' && ch <= '9';
 }
 
-bool BigInt::isZero() {
+bool BigInt::isZero() const {
 	return (digits.size() == 1 && digits[0] == 0);
 }
 
-bool BigInt::isPositiveOne() {
+bool BigInt::isPositiveOne() const {
 	return (!isNegative && digits.size() == 1 && digits[0] == 1);
 }
 
-bool BigInt::isNegativeOne() {
+bool BigInt::isNegativeOne() const {
 	return (isNegative && digits.size() == 1 && digits[0] == 1);
 }
 
-BigInt BigInt::sqrt() {
-	if (*this < 0) {
+// floor(sqrt(this)); the precision of a doubles each step (same scheme as
+// Python's math.isqrt), so only the last division is full size
+BigInt BigInt::sqrt() const {
+	if (isNegative) {
 		throw "ValueError";
 	}
-	BigInt l(0), r(*this);
-	while (r - l > 1) {
-		BigInt m = (l + r) / 2;
-		if (m * m <= *this) {
-			l = m;
-		}
-		else {
-			r = m;
-		}
-	}
-	if (r * r <= *this) {
+	if (digits.size() == 1) {
+		limb_t v = digits[0], r = (limb_t)std::sqrt((double)v);
+		while ((dlimb_t)r * r > v)
+			r--;
+		while ((dlimb_t)(r + 1) * (r + 1) <= v)
+			r++;
 		return r;
 	}
-	else {
-		return l;
+	int c = (bitLength() - 1) / 2;
+	BigInt a = 1;
+	int d = 0;
+	for (int s = 31 - __builtin_clz(c); s >= 0; s--) {
+		// invariant: (a - 1)^2 < (this >> 2 (c - d)) < (a + 1)^2
+		int e = d;
+		d = c >> s;
+		a = (a << (d - e - 1)) + (*this >> (2 * c - e - d + 1)) / a;
 	}
+	if (a.square() > *this)
+		a -= 1;
+	return a;
 }
 
-BigInt BigInt::pow(BigInt n) {
-	if (n < 0) {
+// floor of the k-th root by Newton's iteration from above
+BigInt BigInt::iroot(int k) const {
+	if (k < 1 || isNegative) {
 		throw "ValueError";
 	}
-	if (n == 0) {
+	if (k == 1 || isZero())
+		return *this;
+	if (k == 2)
+		return sqrt();
+	int bits = bitLength();
+	if (k >= bits)
 		return 1;
+
+	// start from a double estimate of 2^(log2(this) / k), nudged above the root
+	int top = min(bits, 53);
+	double lead = 0;
+	for (int i = bits - 1; i >= bits - top; i--)
+		lead = lead * 2 + (testBit(i) ? 1 : 0);
+	double logRoot = (log2(lead) + (bits - top)) / k;
+	int e = max(0, (int)logRoot - 52);
+	BigInt x = BigInt((limb_t)exp2(logRoot - e) + 1) << e;
+	x += (x >> 30) + 1;
+
+	BigInt n1 = k - 1;
+	while (true) {
+		BigInt y = (x * n1 + *this / x.pow(n1)) / k;
+		if (y >= x)
+			break;
+		x = move(y);
 	}
-	if (n == 1) {
-		return *this;
+	return x;
+}
+
+// quadratic residues rule out most non-squares before any root is taken
+bool BigInt::isPerfectSquare() const {
+	if (isNegative)
+		return false;
+	static const struct Residues {
+		bool mod64[64], mod63[63], mod65[65], mod11[11];
+		Residues() {
+			fill(mod64, mod64 + 64, false);
+			fill(mod63, mod63 + 63, false);
+			fill(mod65, mod65 + 65, false);
+			fill(mod11, mod11 + 11, false);
+			for (int i = 0; i < 65; i++) {
+				mod64[i * i % 64] = true;
+				mod63[i * i % 63] = true;
+				mod65[i * i % 65] = true;
+				mod11[i * i % 11] = true;
+			}
+		}
+	} residues;
+	if (!residues.mod64[digits[0] & 63])
+		return false;
+	limb_t r = modWord(63 * 65 * 11);
+	if (!residues.mod63[r % 63] || !residues.mod65[r % 65] || !residues.mod11[r % 11])
+		return false;
+	return sqrt().square() == *this;
+}
+
+BigInt BigInt::pow(const BigInt& n) const {
+	if (n < 0) {
+		throw "ValueError";
 	}
-	BigInt tmp = this->pow(n / 2);
-	tmp = tmp * tmp;
-	if (n % 2 == 1) {
-		tmp = tmp * *this;
+	if (n == 0) {
+		return 1;
 	}
-	return tmp;
+	return slidingWindowPow(*this, n.digits,
+		[](BigInt& acc, const BigInt& x) { acc *= x; },
+		[](BigInt& acc) { acc = acc.square(); });
 }
 
-BigInt BigInt::pow(BigInt n, BigInt mod) {
+// moduli of at least this many limbs that Montgomery can't take (even ones) are
+// reduced by Barrett; below it the one-limb division is faster
+static const int BARRETT_MIN_LIMBS = 2;
+
+BigInt BigInt::pow(const BigInt& n, const BigInt& mod) const {
 	if (n < 0) {
 		throw "ValueError";
 	}
-	//cout << *this << "^" << n << endl;
 	if (n == 0) {
 		return 1;
 	}
-	if (n == 1) {
-		return *this % mod;
+	BigInt m = mod.abs();
+	if (m.isZero()) {
+		throw "DivisionByZero";
+	}
+
+	// work with |this| and fix the sign at the end: (-a)^n = -(a^n) for odd n,
+	// and % keeps the sign of the dividend
+	BigInt res;
+	if (m > 1 && (m.digits[0] & 1)) {
+		MontgomeryContext ctx(m);
+		res = ctx.modexp(abs(), n);
 	}
-	BigInt tmp = this->pow(n / 2, mod);
-	tmp = (tmp * tmp) % mod;
-	if (n % 2 == 1) {
-		tmp = (tmp * *this) % mod;
+	else if ((int)m.digits.size() >= BARRETT_MIN_LIMBS) {
+		BarrettContext ctx(m);
+		res = ctx.modexp(abs(), n);
 	}
-	return tmp;
+	else {
+		res = slidingWindowPow(abs() % m, n.digits,
+			[&m](BigInt& acc, const BigInt& x) {
+				acc *= x;
+				acc %= m;
+			},
+			[&m](BigInt& acc) {
+				acc = acc.square();
+				acc %= m;
+			});
+	}
+	if (isNegative && (n.digits[0] & 1)) {
+		res.isNegative = true;
+		res.clearNumber();
+	}
+	return res;
 }
 
-BigInt BigInt::mathMod(BigInt mod) {
+BigInt BigInt::mathMod(const BigInt& mod) const {
 	BigInt tmp = *this % mod;
-	return tmp + (tmp < 0 ? mod : 0);
+	if (tmp < 0)
+		tmp += mod;
+	return tmp;
 }
 
-int BigInt::getLength() {
-	return digits.size();
+// inverse modulo mod >= 1, throws "ValueError" when gcd(this, mod) != 1
+BigInt BigInt::reversedBySimpleMod(const BigInt& mod) const {
+	if (mod <= 0) {
+		throw "ValueError";
+	}
+	if (mod == 1)
+		return 0;
+	BigInt s, t;
+	if (extendedGcd(mathMod(mod), mod, s, t) != 1) {
+		throw "ValueError";
+	}
+	return s.mathMod(mod);
+}
+
+// decimal conversion
+//
+// Both directions split the number at cached powers P_k = 10^(DEC_BASE_LEN * 2^k):
+// parsing computes high * P_k + low, printing divides by P_k and writes quotient
+// and remainder recursively, so the cost follows multiplication instead of n^2.
+
+static const int DEC_PARSE_BASECASE = 1200;    // digits
+static const int DEC_PRINT_BASECASE = 40;      // limbs
+static const int DEC_RECIP_THRESHOLD = 60;     // limbs of P_k before dividing by reciprocal
+static const int RECIP_BASECASE_BITS = 64 * 40;
+
+struct DecPower {
+	BigInt value;
+	BigInt recip;    // floor(4^bits / value), filled on first use
+	int bits;
+};
+
+static mutex decPowersLock;
+static deque<DecPower> decPowers;
+
+// floor(4^bits / d) for d > 0 of exactly bits bits, by Newton iteration
+static BigInt reciprocal(const BigInt& d, int bits) {
+	BigInt four = BigInt(1) << (2 * bits);
+	if (bits <= RECIP_BASECASE_BITS)
+		return four / d;
+	// reciprocal of the top half, then one Newton step x += x (4^bits - d x) / 4^bits
+	int h = bits / 2 + 2;
+	BigInt x = reciprocal(d >> (bits - h), h) << (bits - h);
+	x += (x * (four - d * x)) >> (2 * bits);
+	// the step leaves x within a few units
+	BigInt r = four - d * x;
+	while (r < 0) {
+		x -= 1;
+		r += d;
+	}
+	while (r >= d) {
+		x += 1;
+		r -= d;
+	}
+	return x;
+}
+
+// q, r of x / d for 0 <= x < 4^bits, recip = reciprocal(d, bits) (Barrett);
+// the estimate is at most two below the quotient and never above it, so r >= 0
+static void divModRecip(const BigInt& x, const BigInt& d, const BigInt& recip, int bits,
+	BigInt& q, BigInt& r) {
+	q = ((x >> (bits - 1)) * recip) >> (bits + 1);
+	r = x - q * d;
+	while (r >= d) {
+		q += 1;
+		r -= d;
+	}
+}
+
+static const DecPower& decPower(int k, bool withRecip) {
+	lock_guard<mutex> guard(decPowersLock);
+	if (decPowers.empty())
+		decPowers.push_back({ BigInt(BigInt::DEC_BASE), BigInt(), 64 });
+	while ((int)decPowers.size() <= k) {
+		BigInt next = decPowers.back().value.square();
+		int bits = bitLengthAbs(next.getDigits());
+		decPowers.push_back({ move(next), BigInt(), bits });
+	}
+	DecPower& p = decPowers[k];
+	if (withRecip && p.recip.isZero())
+		p.recip = reciprocal(p.value, p.bits);
+	return p;
+}
+
+// value of the decimal digits s[0, len)
+BigInt BigInt::parseDecimal(const char* s, int len) {
+	if (len <= DEC_PARSE_BASECASE) {
+		// DEC_BASE_LEN digit chunks, most significant first
+		BigInt res;
+		int first = len % DEC_BASE_LEN;
+		if (first == 0)
+			first = DEC_BASE_LEN;
+		for (int i = 0; i < len; ) {
+			int chunkLen = (i == 0 ? first : DEC_BASE_LEN);
+			limb_t chunk = 0, scale = 1;
+			for (int j = 0; j < chunkLen; j++) {
+				chunk = chunk * 10 + (s[i + j] - '0');
+				scale *= 10;
+			}
+			mulAddWord(res.digits, scale, chunk);
+			i += chunkLen;
+		}
+		res.clearNumber();
+		return res;
+	}
+	int k = 0;
+	while ((DEC_BASE_LEN << (k + 1)) < len)
+		k++;
+	int lowLen = DEC_BASE_LEN << k;
+	BigInt res = parseDecimal(s, len - lowLen) * decPower(k, false).value;
+	res += parseDecimal(s + len - lowLen, lowLen);
+	return res;
 }
 
-vector<int> BigInt::getDigits() {
-	return digits;
+// writes 0 <= x < P_k^2 so that its last digit lands just before end;
+// the positions to the left must already hold '0'
+void BigInt::writeDecimal(const BigInt& x, int k, char* end) {
+	if (k == 0 || (int)x.digits.size() <= DEC_PRINT_BASECASE) {
+		LimbVector rest = x.digits;
+		while (rest.size() > 1 || rest[0] != 0) {
+			limb_t chunk = divModWord(rest, DEC_BASE);
+			while (rest.size() > 1 && rest.back() == 0)
+				rest.pop_back();
+			bool last = rest.size() == 1 && rest[0] == 0;
+			for (int i = 0; i < DEC_BASE_LEN && (chunk != 0 || !last); i++) {
+				*--end = (char)('0' + chunk % 10);
+				chunk /= 10;
+			}
+		}
+		return;
+	}
+	BigInt q, r;
+	const DecPower& p = decPower(k, false);
+	if ((int)p.value.digits.size() >= DEC_RECIP_THRESHOLD) {
+		const DecPower& pr = decPower(k, true);
+		divModRecip(x, pr.value, pr.recip, pr.bits, q, r);
+	}
+	else {
+		divmod(x, p.value, q, r);
+	}
+	writeDecimal(r, k - 1, end);
+	writeDecimal(q, k - 1, end - ((size_t)DEC_BASE_LEN << k));
 }
 
-// input, output
+size_t BigInt::maxStringLength() const {
+	// sign, digits (log10 2 rounded up) and the terminating zero
+	return (isNegative ? 1 : 0) + (size_t)(bitLengthAbs(digits) * 0.30103) + 2;
+}
 
-ostream& operator << (ostream& os, BigInt bigInt) {
-	if (bigInt.isNegative) {
-		os << "-";
-	}
-	os << bigInt.digits.back();
-	for (int i = (int)bigInt.digits.size() - 2; i >= 0; i--) {
-		os << BigInt::formatOutput(bigInt.digits[i]);
+size_t BigInt::toString(char* buf, size_t size) const {
+	size_t need = maxStringLength();
+	if (size < need) {
+		throw "ValueError";
 	}
-	return os;
+	char* start = buf + (isNegative ? 1 : 0);
+	size_t width = buf + need - 1 - start;
+	fill(start, start + width, '0');
+
+	// smallest k with P_k^2 > |this|, judged by bit lengths
+	int k = 0, bits = bitLengthAbs(digits);
+	while (2 * decPower(k, false).bits - 1 <= bits)
+		k++;
+	BigInt mag = abs();
+	writeDecimal(mag, k, start + width);
+
+	size_t lead = 0;
+	while (lead + 1 < width && start[lead] == '0')
+		lead++;
+	memmove(start, start + lead, width - lead);
+	if (isNegative)
+		buf[0] = '-';
+	size_t len = start - buf + width - lead;
+	buf[len] = '\0';
+	return len;
+}
+
+string BigInt::toString() const {
+	string s(maxStringLength(), '\0');
+	s.resize(toString(&s[0], s.size()));
+	return s;
 }
 
-istream& operator >> (istream& in, BigInt& bigInt) {
-	string s;
-	in >> s;
-	bigInt = BigInt(s);
-	return in;
+// binary import/export
+
+static void storeLimb(uint8_t* p, limb_t w, ByteOrder order) {
+	for (int i = 0; i < 8; i++)
+		p[order == ByteOrder::LittleEndian ? i : 7 - i] = (uint8_t)(w >> (8 * i));
 }
 
-//comparing
+static limb_t loadLimb(const uint8_t* p, ByteOrder order) {
+	limb_t w = 0;
+	for (int i = 0; i < 8; i++)
+		w |= (limb_t)p[order == ByteOrder::LittleEndian ? i : 7 - i] << (8 * i);
+	return w;
+}
 
-bool operator == (BigInt bigInt1, BigInt bigInt2) {
-	if (bigInt1.isNegative != bigInt2.isNegative) {
-		return false;
-	}
-	if (bigInt1.digits.size() != bigInt2.digits.size()) {
-		return false;
+static size_t varintLength(size_t x) {
+	size_t len = 1;
+	while (x >= 0x80) {
+		x >>= 7;
+		len++;
 	}
-	for (int i = 0; i < (int)bigInt1.digits.size(); i++) {
-		if (bigInt1.digits[i] != bigInt2.digits[i]) {
-			return false;
-		}
+	return len;
+}
+
+BigIntView::BigIntView(const limb_t* limbs_, size_t count_, bool isNegative_) : limbs(limbs_), count(count_) {
+	while (count > 0 && limbs[count - 1] == 0)
+		count--;
+	negative = isNegative_ && count > 0;
+}
+
+BigIntView::BigIntView(const BigInt& bigInt)
+	: BigIntView(bigInt.getDigits().data(), bigInt.getDigits().size(), bigInt < 0) {}
+
+BigIntView BigIntView::fromBytes(const uint8_t* data, size_t len, bool isNegative_) {
+	if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__ || len % sizeof(limb_t) != 0
+		|| reinterpret_cast<uintptr_t>(data) % alignof(limb_t) != 0) {
+		throw "ValueError";
 	}
-	return true;
+	return BigIntView(reinterpret_cast<const limb_t*>(data), len / sizeof(limb_t), isNegative_);
 }
 
-bool operator == (BigInt bigInt1, int int2) {
-	return bigInt1 == BigInt(int2);
+const limb_t* BigIntView::data() const {
+	return limbs;
 }
 
-bool operator == (int int1, BigInt bigInt2) {
-	return BigInt(int1) == bigInt2;
+size_t BigIntView::size() const {
+	return count;
 }
 
-bool operator != (BigInt bigInt1, BigInt bigInt2) {
-	return !(bigInt1 == bigInt2);
+bool BigIntView::isNegative() const {
+	return negative;
 }
 
-bool operator != (BigInt bigInt1, int int2) {
-	return bigInt1 != BigInt(int2);
+size_t BigIntView::byteLength() const {
+	if (count == 0)
+		return 0;
+	return (count - 1) * 8 + (71 - __builtin_clzll(limbs[count - 1])) / 8;
 }
 
-bool operator != (int int1, BigInt bigInt2) {
-	return BigInt(int1) != bigInt2;
+size_t BigIntView::toBytes(uint8_t* out, size_t size, ByteOrder order) const {
+	size_t bytes = byteLength();
+	if (size < bytes) {
+		throw "ValueError";
+	}
+	// whole limbs first, then the bytes of the top limb
+	size_t full = bytes / 8;
+	for (size_t i = 0; i < full; i++)
+		storeLimb(order == ByteOrder::LittleEndian ? out + 8 * i : out + bytes - 8 * (i + 1), limbs[i], order);
+	for (size_t i = full * 8; i < bytes; i++)
+		out[order == ByteOrder::LittleEndian ? i : bytes - 1 - i] = (uint8_t)(limbs[full] >> (8 * (i % 8)));
+	return bytes;
 }
 
+size_t BigIntView::serializedLength() const {
+	size_t bytes = byteLength();
+	return varintLength(bytes << 1) + bytes;
+}
 
-bool operator > (BigInt bigInt1, BigInt bigInt2) {
-	if (bigInt1.isNegative && !bigInt2.isNegative) {
-		return false;
+size_t BigIntView::serialize(uint8_t* out, size_t size) const {
+	if (size < serializedLength()) {
+		throw "ValueError";
 	}
-	if (!bigInt1.isNegative && bigInt2.isNegative) {
-		return true;
+	size_t bytes = byteLength();
+	size_t header = bytes << 1 | (negative ? 1 : 0), pos = 0;
+	while (header >= 0x80) {
+		out[pos++] = (uint8_t)(header | 0x80);
+		header >>= 7;
 	}
+	out[pos++] = (uint8_t)header;
+	return pos + toBytes(out + pos, bytes, ByteOrder::BigEndian);
+}
 
-	if (!bigInt1.isNegative) {
-		if (bigInt1.digits.size() > bigInt2.digits.size()) {
-			return true;
-		}
-		if (bigInt1.digits.size() < bigInt2.digits.size()) {
-			return false;
-		}
-		for (int i = bigInt1.digits.size() - 1; i >= 0; i--) {
-			if (bigInt1.digits[i] > bigInt2.digits[i]) {
-				return true;
-			}
-			if (bigInt1.digits[i] < bigInt2.digits[i]) {
-				return false;
-			}
+BigInt BigIntView::toBigInt() const {
+	return BigInt(*this);
+}
+
+BigInt BigInt::fromBytes(const uint8_t* data, size_t len, ByteOrder order, bool isNegative_) {
+	LimbVector limbs((len + 7) / 8, 0);
+	size_t full = len / 8;
+	for (size_t i = 0; i < full; i++)
+		limbs[i] = loadLimb(order == ByteOrder::LittleEndian ? data + 8 * i : data + len - 8 * (i + 1), order);
+	for (size_t i = full * 8; i < len; i++)
+		limbs[full] |= (limb_t)data[order == ByteOrder::LittleEndian ? i : len - 1 - i] << (8 * (i % 8));
+	return BigInt(move(limbs), isNegative_);
+}
+
+size_t BigInt::byteLength() const {
+	return BigIntView(*this).byteLength();
+}
+
+size_t BigInt::toBytes(uint8_t* out, size_t size, ByteOrder order) const {
+	return BigIntView(*this).toBytes(out, size, order);
+}
+
+vector<uint8_t> BigInt::toBytes(ByteOrder order) const {
+	vector<uint8_t> res(byteLength());
+	toBytes(res.data(), res.size(), order);
+	return res;
+}
+
+size_t BigInt::serializedLength() const {
+	return BigIntView(*this).serializedLength();
+}
+
+size_t BigInt::serialize(uint8_t* out, size_t size) const {
+	return BigIntView(*this).serialize(out, size);
+}
+
+vector<uint8_t> BigInt::serialize() const {
+	vector<uint8_t> res(serializedLength());
+	serialize(res.data(), res.size());
+	return res;
+}
+
+BigInt BigInt::deserialize(const uint8_t* data, size_t size, size_t* consumed) {
+	size_t header = 0, pos = 0;
+	for (int shift = 0; ; shift += 7) {
+		if (pos == size || shift > 56) {
+			throw "ValueError";
 		}
-		return false;
+		uint8_t b = data[pos++];
+		header |= (size_t)(b & 0x7f) << shift;
+		if (!(b & 0x80))
+			break;
 	}
-	else {
-		return bigInt2.abs() > bigInt1.abs();
+	size_t bytes = header >> 1;
+	if (bytes > size - pos || (bytes == 0 && (header & 1))) {
+		throw "ValueError";
 	}
+	if (consumed)
+		*consumed = pos + bytes;
+	return fromBytes(data + pos, bytes, ByteOrder::BigEndian, header & 1);
 }
 
-bool operator > (BigInt bigInt1, int int2) {
-	return bigInt1 > BigInt(int2);
+int BigInt::getLength() const {
+	return digits.size();
 }
 
-bool operator > (int int1, BigInt bigInt2) {
-	return BigInt(int1) > bigInt2;
+const LimbVector& BigInt::getDigits() const {
+	return digits;
 }
 
-bool operator >= (BigInt bigInt1, BigInt bigInt2) {
-	return bigInt1 > bigInt2 || bigInt1 == bigInt2;
-}
+// input, output
 
-bool operator >= (BigInt bigInt1, int int2) {
-	return bigInt1 >= BigInt(int2);
+ostream& operator << (ostream& os, const BigInt& bigInt) {
+	return os << bigInt.toString();
 }
 
-bool operator >= (int int1, BigInt bigInt2) {
-	return BigInt(int1) >= bigInt2;
+istream& operator >> (istream& in, BigInt& bigInt) {
+	string s;
+	in >> s;
+	bigInt = BigInt(s);
+	return in;
 }
 
+//comparing
 
-bool operator < (BigInt bigInt1, BigInt bigInt2) {
-	return bigInt2 > bigInt1;
+bool operator == (const BigInt& bigInt1, const BigInt& bigInt2) {
+	return bigInt1.isNegative == bigInt2.isNegative && bigInt1.digits == bigInt2.digits;
 }
 
-bool operator < (BigInt bigInt1, int int2) {
-	return bigInt1 < BigInt(int2);
+bool operator != (const BigInt& bigInt1, const BigInt& bigInt2) {
+	return !(bigInt1 == bigInt2);
 }
 
-bool operator < (int int1, BigInt bigInt2) {
-	return BigInt(int1) < bigInt2;
+bool operator > (const BigInt& bigInt1, const BigInt& bigInt2) {
+	if (bigInt1.isNegative != bigInt2.isNegative) {
+		return bigInt2.isNegative;
+	}
+	int cmp = compareAbs(bigInt1.digits, bigInt2.digits);
+	return bigInt1.isNegative ? cmp < 0 : cmp > 0;
 }
 
-bool operator <= (BigInt bigInt1, BigInt bigInt2) {
-	return bigInt1 < bigInt2 || bigInt1 == bigInt2;
+bool operator >= (const BigInt& bigInt1, const BigInt& bigInt2) {
+	return !(bigInt2 > bigInt1);
 }
 
-bool operator <= (BigInt bigInt1, int int2) {
-	return bigInt1 <= BigInt(int2);
+bool operator < (const BigInt& bigInt1, const BigInt& bigInt2) {
+	return bigInt2 > bigInt1;
 }
 
-bool operator <= (int int1, BigInt bigInt2) {
-	return BigInt(int1) <= bigInt2;
+bool operator <= (const BigInt& bigInt1, const BigInt& bigInt2) {
+	return !(bigInt1 > bigInt2);
 }
 
-// +, -, *, /
+// single-limb kernels behind the native integer overloads
 
-BigInt operator + (BigInt bigInt1, BigInt bigInt2) {
-	if (bigInt1.isNegative != bigInt2.isNegative) {
-		BigInt res;
-		if (bigInt1.abs() > bigInt2.abs()) {
-			res = BigInt((bigInt1.abs() - bigInt2.abs()).digits, bigInt1.isNegative);
+// sign of this - (negative ? -mag : mag)
+int BigInt::compareWord(limb_t mag, bool negative) const {
+	if (isNegative != negative) {
+		return isNegative ? -1 : 1;
+	}
+	int cmp = digits.size() > 1 ? 1 : (digits[0] > mag) - (digits[0] < mag);
+	return isNegative ? -cmp : cmp;
+}
+
+void BigInt::addWord(limb_t mag, bool negative) {
+	if (mag == 0) {
+		return;
+	}
+	if (isNegative == negative || isZero()) {
+		isNegative = negative;
+		for (int i = 0; i < (int)digits.size() && mag; i++) {
+			digits[i] += mag;
+			mag = digits[i] < mag;
 		}
-		else {
-			res = BigInt((bigInt2.abs() - bigInt1.abs()).digits, bigInt2.isNegative);
+		if (mag)
+			digits.push_back(mag);
+	}
+	else if (digits.size() > 1 || digits[0] >= mag) {
+		for (int i = 0; mag; i++) {
+			limb_t old = digits[i];
+			digits[i] = old - mag;
+			mag = old < mag;
 		}
-		res.clearNumber();
-		return res;
+		clearNumber();
 	}
 	else {
-		vector <int> resDigits(1, 0);
-		int carry = 0;
-		for (int i = 0; i < max((int)bigInt1.digits.size(), (int)bigInt2.digits.size()) || carry; i++) {
-			if (i == (int)resDigits.size()) {
-				resDigits.push_back(0);
-			}
-			resDigits[i] = carry + (i < (int)bigInt1.digits.size() ? bigInt1.digits[i] : 0) + (i < (int)bigInt2.digits.size() ? bigInt2.digits[i] : 0);
-			carry = resDigits[i] / BigInt::BASE;
-			resDigits[i] %= BigInt::BASE;
-		}
-		BigInt res(resDigits, bigInt1.isNegative);
-		res.clearNumber();
-		return res;
+		digits[0] = mag - digits[0];
+		isNegative = negative;
 	}
 }
 
-BigInt operator + (BigInt bigInt1, int int2) {
-	return bigInt1 + BigInt(int2);
+void BigInt::mulWord(limb_t mag, bool negative) {
+	if (mag == 0) {
+		digits.assign(1, 0);
+		isNegative = false;
+		return;
+	}
+	if (mag != 1)
+		mulAddWord(digits, mag, 0);
+	isNegative ^= negative;
+	clearNumber();
 }
 
-BigInt operator + (int int1, BigInt bigInt2) {
-	return BigInt(int1) + bigInt2;
+// truncated quotient, in place
+void BigInt::divWord(limb_t mag, bool negative) {
+	if (mag == 0) {
+		throw "DivisionByZero";
+	}
+	if ((mag & (mag - 1)) == 0)
+		shiftRightInPlace(digits, __builtin_ctzll(mag));
+	else
+		divModWord(digits, mag);
+	isNegative ^= negative;
+	clearNumber();
 }
 
-const BigInt operator ++ (BigInt& a, int) {
-	BigInt oldA = a;
-	a = a + 1;
-	return oldA;
+// |this| mod mag without touching this
+limb_t BigInt::modWord(limb_t mag) const {
+	if (mag == 0) {
+		throw "DivisionByZero";
+	}
+	if ((mag & (mag - 1)) == 0)
+		return digits[0] & (mag - 1);
+	dlimb_t rem = 0;
+	for (int i = (int)digits.size() - 1; i >= 0; i--)
+		rem = ((rem << 64) | digits[i]) % mag;
+	return (limb_t)rem;
 }
 
+// compound assignment
 
-BigInt operator - (BigInt bigInt1, BigInt bigInt2) {
-	if (bigInt1.isNegative != bigInt2.isNegative) {
-		BigInt res((bigInt1.abs() + bigInt2.abs()).digits, bigInt1.isNegative);
-		res.clearNumber();
-		return res;
+// this += (otherNegative ? -other : other), other may alias digits
+void BigInt::addMagnitude(const LimbVector& other, bool otherNegative) {
+	if (isNegative == otherNegative) {
+		addAbsInPlace(digits, other);
 	}
-	else
-		if (bigInt1.isNegative) {
-			return bigInt2.abs() - bigInt1.abs();
-		}
-		else
-			if (bigInt1 < bigInt2) {
-				return BigInt((bigInt2 - bigInt1).digits, true);
-			}
-			else {
-				vector <int> resDigits = bigInt1.digits;
-				int carry = 0;
-				for (int i = 0; i < (int)bigInt2.digits.size() || carry; i++) {
-					resDigits[i] -= carry + (i < (int)bigInt2.digits.size() ? bigInt2.digits[i] : 0);
-					carry = resDigits[i] < 0;
-					if (carry) {
-						resDigits[i] += BigInt::BASE;
-					}
-				}
-				BigInt res(resDigits, false);
-				res.clearNumber();
-				return res;
-			}
+	else if (compareAbs(digits, other) >= 0) {
+		subAbsInPlace(digits, other);
+	}
+	else {
+		subAbsReversed(digits, other);
+		isNegative = otherNegative;
+	}
+	clearNumber();
 }
 
-BigInt operator - (BigInt bigInt1, int int2) {
-	return bigInt1 - BigInt(int2);
+BigInt& BigInt::operator += (const BigInt& other) {
+	addMagnitude(other.digits, other.isNegative);
+	return *this;
 }
 
-BigInt operator - (int int1, BigInt bigInt2) {
-	return BigInt(int1) - bigInt2;
+BigInt& BigInt::operator -= (const BigInt& other) {
+	addMagnitude(other.digits, !other.isNegative);
+	return *this;
 }
 
-BigInt BigInt::operator - () {
-	return BigInt(digits, !isNegative);
+BigInt& BigInt::operator *= (const BigInt& other) {
+	*this = *this * other;
+	return *this;
 }
 
+BigInt& BigInt::operator /= (const BigInt& other) {
+	BigInt remainder;
+	divmod(*this, other, *this, remainder);
+	return *this;
+}
 
-BigInt operator * (BigInt bigInt1, BigInt bigInt2) {
-	if (bigInt1.isZero() || bigInt2.isZero()) {
-		return BigInt(0);
+BigInt& BigInt::operator %= (const BigInt& other) {
+	BigInt quotient;
+	divmod(*this, other, quotient, *this);
+	return *this;
+}
+
+BigInt& BigInt::operator <<= (int shift) {
+	if (shift < 0) {
+		throw "ValueError";
 	}
-	else
+	shiftLeftInPlace(digits, shift);
+	return *this;
+}
+
+BigInt& BigInt::operator >>= (int shift) {
+	if (shift < 0) {
+		throw "ValueError";
+	}
+	shiftRightInPlace(digits, shift);
+	clearNumber();
+	return *this;
+}
+
+// +, -, *, /
+
+BigInt operator + (const BigInt& bigInt1, const BigInt& bigInt2) {
+	BigInt res(bigInt1);
+	res += bigInt2;
+	return res;
+}
+
+BigInt operator + (BigInt&& bigInt1, const BigInt& bigInt2) {
+	bigInt1 += bigInt2;
+	return move(bigInt1);
+}
+
+const BigInt operator ++ (BigInt& a, int) {
+	BigInt oldA = a;
+	a += 1;
+	return oldA;
+}
+
+BigInt operator - (const BigInt& bigInt1, const BigInt& bigInt2) {
+	BigInt res(bigInt1);
+	res -= bigInt2;
+	return res;
+}
+
+BigInt operator - (BigInt&& bigInt1, const BigInt& bigInt2) {
+	bigInt1 -= bigInt2;
+	return move(bigInt1);
+}
+
+BigInt BigInt::operator - () const {
+	BigInt res(*this);
+	res.isNegative = !isNegative;
+	res.clearNumber();
+	return res;
+}
+
+BigInt operator << (const BigInt& bigInt, int shift) {
+	BigInt res(bigInt);
+	res <<= shift;
+	return res;
+}
+
+BigInt operator << (BigInt&& bigInt, int shift) {
+	bigInt <<= shift;
+	return move(bigInt);
+}
+
+BigInt operator >> (const BigInt& bigInt, int shift) {
+	BigInt res(bigInt);
+	res >>= shift;
+	return res;
+}
+
+BigInt operator >> (BigInt&& bigInt, int shift) {
+	bigInt >>= shift;
+	return move(bigInt);
+}
+
+// multiplication kernels on raw limb spans, results always have na + nb limbs
+
+// operand sizes (in limbs) above which the subquadratic algorithms win
+static const int KARATSUBA_THRESHOLD = 48;
+static const int TOOM3_THRESHOLD = 800;
+static const int NTT_THRESHOLD = 3000;
+static const int SQR_KARATSUBA_THRESHOLD = 96;
+
+static vector<limb_t> mulLimbs(const limb_t* a, int na, const limb_t* b, int nb);
+static vector<limb_t> sqrLimbs(const limb_t* a, int n);
+
+static void mulSchoolbook(const limb_t* a, int na, const limb_t* b, int nb, limb_t* res) {
+	fill(res, res + na + nb, 0);
+	for (int i = 0; i < na; i++) {
+		limb_t carry = 0;
+		for (int j = 0; j < nb; j++) {
+			dlimb_t cur = (dlimb_t)a[i] * b[j] + res[i + j] + carry;
+			res[i + j] = (limb_t)cur;
+			carry = (limb_t)(cur >> 64);
+		}
+		res[i + nb] = carry;
+	}
+}
+
+// res[offset..] += x, res must be long enough to absorb the carry
+static void addShifted(vector<limb_t>& res, const limb_t* x, int nx, int offset) {
+	limb_t carry = 0;
+	int i = 0;
+	for (; i < nx; i++) {
+		dlimb_t cur = (dlimb_t)res[offset + i] + x[i] + carry;
+		res[offset + i] = (limb_t)cur;
+		carry = (limb_t)(cur >> 64);
+	}
+	for (; carry && offset + i < (int)res.size(); i++) {
+		res[offset + i] += 1;
+		carry = res[offset + i] == 0;
+	}
+}
+
+static vector<limb_t> spanAdd(const limb_t* a, int na, const limb_t* b, int nb) {
+	return addAbs(vector<limb_t>(a, a + na), vector<limb_t>(b, b + nb));
+}
+
+// a * b = z2 * X^2 + ((a0 + a1)(b0 + b1) - z0 - z2) * X + z0, X = 2^(64h)
+static vector<limb_t> mulKaratsuba(const limb_t* a, int na, const limb_t* b, int nb) {
+	int h = (max(na, nb) + 1) / 2;
+	int na0 = min(na, h), nb0 = min(nb, h);
+	int na1 = na - na0, nb1 = nb - nb0;
+
+	vector<limb_t> res(na + nb, 0);
+	vector<limb_t> z0 = mulLimbs(a, na0, b, nb0);
+	vector<limb_t> z2 = (na1 && nb1) ? mulLimbs(a + h, na1, b + h, nb1) : vector<limb_t>(1, 0);
+	vector<limb_t> sa = spanAdd(a, na0, a + h, na1);
+	vector<limb_t> sb = spanAdd(b, nb0, b + h, nb1);
+	vector<limb_t> z1 = mulLimbs(sa.data(), (int)sa.size(), sb.data(), (int)sb.size());
+	subAbsInPlace(z1, z0);
+	subAbsInPlace(z1, z2);
+
+	addShifted(res, z0.data(), (int)z0.size(), 0);
+	while (z1.size() > 1 && z1.back() == 0)
+		z1.pop_back();
+	addShifted(res, z1.data(), (int)z1.size(), h);
+	if (na1 && nb1)
+		addShifted(res, z2.data(), (int)z2.size(), 2 * h);
+	return res;
+}
+
+// cross products a[i] * a[j], i < j, are computed once and doubled, then the
+// diagonal squares are added in
+static void sqrSchoolbook(const limb_t* a, int n, limb_t* res) {
+	fill(res, res + 2 * n, 0);
+	for (int i = 0; i < n; i++) {
+		limb_t carry = 0;
+		for (int j = i + 1; j < n; j++) {
+			dlimb_t cur = (dlimb_t)a[i] * a[j] + res[i + j] + carry;
+			res[i + j] = (limb_t)cur;
+			carry = (limb_t)(cur >> 64);
+		}
+		res[i + n] = carry;
+	}
+
+	limb_t top = 0;
+	for (int i = 0; i < 2 * n; i++) {
+		limb_t next = res[i] >> 63;
+		res[i] = (res[i] << 1) | top;
+		top = next;
+	}
+
+	limb_t carry = 0;
+	for (int i = 0; i < n; i++) {
+		dlimb_t cur = (dlimb_t)a[i] * a[i] + res[2 * i] + carry;
+		res[2 * i] = (limb_t)cur;
+		cur = (dlimb_t)res[2 * i + 1] + (limb_t)(cur >> 64);
+		res[2 * i + 1] = (limb_t)cur;
+		carry = (limb_t)(cur >> 64);
+	}
+}
+
+// a^2 = a1^2 * X^2 + ((a0 + a1)^2 - a0^2 - a1^2) * X + a0^2, X = 2^(64h)
+static vector<limb_t> sqrKaratsuba(const limb_t* a, int n) {
+	int h = (n + 1) / 2;
+	vector<limb_t> res(2 * n, 0);
+	vector<limb_t> z0 = sqrLimbs(a, h);
+	vector<limb_t> z2 = sqrLimbs(a + h, n - h);
+	vector<limb_t> s = spanAdd(a, h, a + h, n - h);
+	vector<limb_t> z1 = sqrLimbs(s.data(), (int)s.size());
+	subAbsInPlace(z1, z0);
+	subAbsInPlace(z1, z2);
+
+	addShifted(res, z0.data(), (int)z0.size(), 0);
+	while (z1.size() > 1 && z1.back() == 0)
+		z1.pop_back();
+	addShifted(res, z1.data(), (int)z1.size(), h);
+	addShifted(res, z2.data(), (int)z2.size(), 2 * h);
+	return res;
+}
+
+static BigInt limbSlice(const limb_t* a, int na, int from, int len) {
+	from = min(from, na);
+	len = min(len, na - from);
+	if (len <= 0)
+		return BigInt(0);
+	return BigInt(vector<limb_t>(a + from, a + from + len), false);
+}
+
+// Toom-Cook 3-way with Bodrato's evaluation points 0, 1, -1, -2, inf
+static vector<limb_t> mulToom3(const limb_t* a, int na, const limb_t* b, int nb) {
+	bool square = a == b && na == nb;
+	int k = (max(na, nb) + 2) / 3;
+	BigInt a0 = limbSlice(a, na, 0, k), a1 = limbSlice(a, na, k, k), a2 = limbSlice(a, na, 2 * k, k);
+	BigInt b0 = limbSlice(b, nb, 0, k), b1 = limbSlice(b, nb, k, k), b2 = limbSlice(b, nb, 2 * k, k);
+
+	BigInt pa = a0 + a2, pb = b0 + b2;
+	BigInt pa1 = pa + a1, pb1 = pb + b1;
+	BigInt paM1 = pa - a1, pbM1 = pb - b1;
+	BigInt paM2 = (paM1 + a2) * 2 - a0, pbM2 = (pbM1 + b2) * 2 - b0;
+
+	BigInt r0 = square ? a0.square() : a0 * b0;
+	BigInt r1 = square ? pa1.square() : pa1 * pb1;
+	BigInt rM1 = square ? paM1.square() : paM1 * pbM1;
+	BigInt rM2 = square ? paM2.square() : paM2 * pbM2;
+	BigInt rInf = square ? a2.square() : a2 * b2;
+
+	// interpolation, every division here is exact
+	BigInt c3 = (rM2 - r1) / 3;
+	BigInt c1 = (r1 - rM1) / 2;
+	BigInt c2 = rM1 - r0;
+	c3 = (c2 - c3) / 2 + rInf * 2;
+	c2 = c2 + c1 - rInf;
+	c1 = c1 - c3;
+
+	vector<limb_t> res(na + nb + 1, 0);
+	BigInt coeffs[] = { r0, c1, c2, c3, rInf };
+	for (int i = 0; i < 5; i++) {
+		if (!coeffs[i].isZero())
+			addShifted(res, coeffs[i].getDigits().data(), (int)coeffs[i].getDigits().size(), i * k);
+	}
+	res.resize(na + nb);
+	return res;
+}
+
+// number-theoretic transform over three 62-bit primes c * 2^40 + 1; a
+// convolution term of 64-bit limbs is below L * 2^128, which stays under the
+// product of the primes for any length we can allocate, so CRT is exact
+struct NttPrime {
+	limb_t p;
+	limb_t pInv;	// -p^-1 mod 2^64
+	limb_t r2;		// 2^128 mod p
+
+	NttPrime(limb_t p_) {
+		p = p_;
+		limb_t inv = p;
+		for (int i = 0; i < 5; i++)
+			inv *= 2 - p * inv;
+		pInv = (limb_t)0 - inv;
+		r2 = (limb_t)((((dlimb_t)1 << 64) % p) * (((dlimb_t)1 << 64) % p) % p);
+	}
+
+	// Montgomery product a * b * 2^-64 mod p
+	limb_t mul(limb_t a, limb_t b) const {
+		dlimb_t t = (dlimb_t)a * b;
+		limb_t m = (limb_t)t * pInv;
+		limb_t res = (limb_t)((t + (dlimb_t)m * p) >> 64);
+		return res >= p ? res - p : res;
+	}
+	limb_t add(limb_t a, limb_t b) const {
+		limb_t s = a + b;
+		return s >= p ? s - p : s;
+	}
+	limb_t sub(limb_t a, limb_t b) const {
+		return a >= b ? a - b : a + p - b;
+	}
+	limb_t toMont(limb_t a) const {
+		return mul(a % p, r2);
+	}
+	// x^e with x and the result in Montgomery form
+	limb_t pow(limb_t x, limb_t e) const {
+		limb_t res = toMont(1);
+		while (e) {
+			if (e & 1)
+				res = mul(res, x);
+			x = mul(x, x);
+			e >>= 1;
+		}
+		return res;
+	}
+};
+
+static const limb_t NTT_PRIMES[3] = { 4611549678985543681ULL, 4611613450659954689ULL, 4611615649683210241ULL };
+static const limb_t NTT_ROOTS[3] = { 19, 3, 11 };
+static const int NTT_MAX_LOG = 40;
+
+// twiddles w^j, j < n / 2, in Montgomery form for a primitive n-th root w
+static vector<limb_t> nttRoots(const NttPrime& P, limb_t g, int n, bool inverse) {
+	limb_t w = P.pow(P.toMont(g), (P.p - 1) / n);
+	if (inverse)
+		w = P.pow(w, P.p - 2);
+	vector<limb_t> roots(max(n / 2, 1));
+	roots[0] = P.toMont(1);
+	for (int j = 1; j < n / 2; j++)
+		roots[j] = P.mul(roots[j - 1], w);
+	return roots;
+}
+
+// decimation in frequency, natural order in, bit-reversed order out
+static void nttForward(vector<limb_t>& a, const NttPrime& P, const vector<limb_t>& roots) {
+	int n = (int)a.size();
+	for (int len = n; len >= 2; len >>= 1) {
+		int half = len / 2, step = n / len;
+		for (int i = 0; i < n; i += len) {
+			for (int j = 0; j < half; j++) {
+				limb_t u = a[i + j], v = a[i + j + half];
+				a[i + j] = P.add(u, v);
+				a[i + j + half] = P.mul(P.sub(u, v), roots[j * step]);
+			}
+		}
+	}
+}
+
+// decimation in time, bit-reversed order in, natural order out, scaled by n
+static void nttInverse(vector<limb_t>& a, const NttPrime& P, const vector<limb_t>& roots) {
+	int n = (int)a.size();
+	for (int len = 2; len <= n; len <<= 1) {
+		int half = len / 2, step = n / len;
+		for (int i = 0; i < n; i += len) {
+			for (int j = 0; j < half; j++) {
+				limb_t u = a[i + j], v = P.mul(a[i + j + half], roots[j * step]);
+				a[i + j] = P.add(u, v);
+				a[i + j + half] = P.sub(u, v);
+			}
+		}
+	}
+}
+
+// cyclic convolution of a and b modulo one prime, len coefficients
+static vector<limb_t> nttConvolve(const limb_t* a, int na, const limb_t* b, int nb, bool square, int n, int prime) {
+	NttPrime P(NTT_PRIMES[prime]);
+	vector<limb_t> fa(n, 0), fb;
+	for (int i = 0; i < na; i++)
+		fa[i] = a[i] % P.p;
+	vector<limb_t> roots = nttRoots(P, NTT_ROOTS[prime], n, false);
+	nttForward(fa, P, roots);
+	if (!square) {
+		fb.assign(n, 0);
+		for (int i = 0; i < nb; i++)
+			fb[i] = b[i] % P.p;
+		nttForward(fb, P, roots);
+	}
+
+	// pointwise product leaves a 2^-64 factor, fold it into the 1/n scaling
+	limb_t nInv = P.pow(P.toMont(n), P.p - 2);
+	limb_t scale = P.toMont(P.toMont(P.mul(nInv, 1)));
+	for (int i = 0; i < n; i++)
+		fa[i] = P.mul(P.mul(fa[i], square ? fa[i] : fb[i]), scale);
+
+	nttInverse(fa, P, nttRoots(P, NTT_ROOTS[prime], n, true));
+	return fa;
+}
+
+static vector<limb_t> mulNtt(const limb_t* a, int na, const limb_t* b, int nb) {
+	int len = na + nb - 1, logN = 0;
+	while ((1 << logN) < len)
+		logN++;
+	if (logN > NTT_MAX_LOG)
+		throw "Numbers are too big";
+	int n = 1 << logN;
+
+	// squaring needs one forward transform per prime instead of two
+	bool square = na == nb && equal(a, a + na, b);
+	vector<limb_t> r[3];
+	for (int k = 0; k < 3; k++)
+		r[k] = nttConvolve(a, na, b, nb, square, n, k);
+
+	// Garner's CRT: x = r0 + p0 * (y1 + p1 * y2); the inverses are kept in
+	// Montgomery form, so mul(x, inv) is the plain product x * inv mod p
+	NttPrime P1(NTT_PRIMES[1]), P2(NTT_PRIMES[2]);
+	limb_t p0 = NTT_PRIMES[0], p1 = NTT_PRIMES[1];
+	limb_t inv01 = P1.pow(P1.toMont(p0), P1.p - 2);
+	limb_t inv02 = P2.pow(P2.toMont(p0), P2.p - 2);
+	limb_t inv12 = P2.pow(P2.toMont(p1), P2.p - 2);
+	dlimb_t p01 = (dlimb_t)p0 * p1;
+	limb_t p01Lo = (limb_t)p01, p01Hi = (limb_t)(p01 >> 64);
+
+	vector<limb_t> res(na + nb, 0);
+	limb_t c0 = 0, c1 = 0, c2 = 0;
+	for (int i = 0; i < na + nb; i++) {
+		if (i < len) {
+			limb_t x0 = r[0][i];
+			limb_t y1 = P1.mul(P1.sub(r[1][i], x0 % P1.p), inv01);
+			limb_t t = P2.mul(P2.sub(r[2][i], x0 % P2.p), inv02);
+			limb_t y2 = P2.mul(P2.sub(t, y1 % P2.p), inv12);
+
+			// x = x0 + p0 * y1 + p0 * p1 * y2 as three limbs
+			dlimb_t lo = (dlimb_t)p0 * y1 + x0;
+			dlimb_t mid = (dlimb_t)p01Lo * y2;
+			dlimb_t hi = (dlimb_t)p01Hi * y2;
+			dlimb_t s = (dlimb_t)(limb_t)lo + (limb_t)mid + c0;
+			c0 = (limb_t)s;
+			s = (s >> 64) + (limb_t)(lo >> 64) + (limb_t)(mid >> 64) + (limb_t)hi + c1;
+			c1 = (limb_t)s;
+			c2 += (limb_t)(s >> 64) + (limb_t)(hi >> 64);
+		}
+		res[i] = c0;
+		c0 = c1;
+		c1 = c2;
+		c2 = 0;
+	}
+	return res;
+}
+
+static vector<limb_t> mulLimbs(const limb_t* a, int na, const limb_t* b, int nb) {
+	if (na < nb) {
+		swap(a, b);
+		swap(na, nb);
+	}
+	vector<limb_t> res(na + nb, 0);
+	if (nb < KARATSUBA_THRESHOLD) {
+		mulSchoolbook(a, na, b, nb, res.data());
+	}
+	else if (nb >= NTT_THRESHOLD) {
+		res = mulNtt(a, na, b, nb);
+	}
+	else if (na >= 2 * nb) {
+		// unbalanced: multiply nb-sized slices of a and accumulate
+		for (int i = 0; i < na; i += nb) {
+			int len = min(nb, na - i);
+			vector<limb_t> part = mulLimbs(a + i, len, b, nb);
+			addShifted(res, part.data(), (int)part.size(), i);
+		}
+	}
+	else if (nb < TOOM3_THRESHOLD) {
+		res = mulKaratsuba(a, na, b, nb);
+	}
+	else {
+		res = mulToom3(a, na, b, nb);
+	}
+	return res;
+}
+
+static vector<limb_t> sqrLimbs(const limb_t* a, int n) {
+	vector<limb_t> res(2 * n, 0);
+	if (n < SQR_KARATSUBA_THRESHOLD) {
+		sqrSchoolbook(a, n, res.data());
+	}
+	else if (n >= NTT_THRESHOLD) {
+		res = mulNtt(a, n, a, n);
+	}
+	else if (n < TOOM3_THRESHOLD) {
+		res = sqrKaratsuba(a, n);
+	}
+	else {
+		res = mulToom3(a, n, a, n);
+	}
+	return res;
+}
+
+BigInt operator * (const BigInt& bigInt1, const BigInt& bigInt2) {
+	if (bigInt1.isZero() || bigInt2.isZero()) {
+		return BigInt(0);
+	}
+	else
 		if (bigInt1.isPositiveOne()) {
 			return bigInt2;
 		}
@@ -443,546 +1545,2313 @@ BigInt operator * (BigInt bigInt1, BigInt bigInt2) {
 						return -bigInt1;
 					}
 					else {
-						vector <int> resDigits(bigInt1.digits.size() + bigInt2.digits.size());
-						for (int i = 0; i < (int)bigInt1.digits.size(); i++) {
-							for (int j = 0, carry = 0; j < (int)bigInt2.digits.size() || carry; j++) {
-								resDigits[i + j] += bigInt1.digits[i] * (j < (int)bigInt2.digits.size() ? bigInt2.digits[j] : 0) + carry;
-								carry = resDigits[i + j] / BigInt::BASE;
-								resDigits[i + j] %= BigInt::BASE;
-							}
-						}
-						BigInt res(resDigits, bigInt1.isNegative ^ bigInt2.isNegative);
+						BigInt res(mulLimbs(bigInt1.digits.data(), (int)bigInt1.digits.size(), bigInt2.digits.data(), (int)bigInt2.digits.size()),
+							bigInt1.isNegative ^ bigInt2.isNegative);
 						res.clearNumber();
 						return res;
 					}
 }
 
-BigInt operator * (BigInt bigInt1, int int2) {
-	return bigInt1 * BigInt(int2);
+BigInt operator * (BigInt&& bigInt1, const BigInt& bigInt2) {
+	bigInt1 *= bigInt2;
+	return move(bigInt1);
+}
+
+BigInt BigInt::square() const {
+	BigInt res(sqrLimbs(digits.data(), (int)digits.size()), false);
+	res.clearNumber();
+	return res;
 }
 
-BigInt operator * (int int1, BigInt bigInt2) {
-	return BigInt(int1) * bigInt2;
+BigInt BigInt::square(const BigInt& mod) const {
+	return square() % mod;
 }
 
+// bit access
 
-BigInt BigInt::div2() {
-	int carry = 0;
-	vector <int> resDigits = digits;
-	for (int i = (int)resDigits.size() - 1; i >= 0; i--) {
-		resDigits[i] = resDigits[i] + carry * BASE;
-		carry = resDigits[i] % 2;
-		resDigits[i] /= 2;
+int BigInt::bitLength() const {
+	return bitLengthAbs(digits);
+}
+
+bool BigInt::testBit(int i) const {
+	if (i < 0) {
+		throw "ValueError";
+	}
+	return i / 64 < (int)digits.size() && ((digits[i / 64] >> (i % 64)) & 1);
+}
+
+void BigInt::setBit(int i) {
+	if (i < 0) {
+		throw "ValueError";
+	}
+	if (i / 64 >= (int)digits.size())
+		digits.resize(i / 64 + 1, 0);
+	digits[i / 64] |= (limb_t)1 << (i % 64);
+}
+
+void BigInt::clearBit(int i) {
+	if (i < 0) {
+		throw "ValueError";
 	}
-	BigInt res(resDigits, isNegative);
+	if (i / 64 < (int)digits.size()) {
+		digits[i / 64] &= ~((limb_t)1 << (i % 64));
+		clearNumber();
+	}
+}
+
+int BigInt::lowestSetBit() const {
+	for (int i = 0; i < (int)digits.size(); i++) {
+		if (digits[i])
+			return i * 64 + __builtin_ctzll(digits[i]);
+	}
+	return -1;
+}
+
+int BigInt::popcount() const {
+	int count = 0;
+	for (int i = 0; i < (int)digits.size(); i++)
+		count += __builtin_popcountll(digits[i]);
+	return count;
+}
+
+string BigInt::toBinaryString() const {
+	int bits = bitLength();
+	if (bits == 0)
+		return "0";
+	int sign = isNegative ? 1 : 0;
+	string s(sign + bits, '0');
+	if (isNegative)
+		s[0] = '-';
+	for (int i = 0; i < bits; i++) {
+		if ((digits[i / 64] >> (i % 64)) & 1)
+			s[sign + bits - 1 - i] = '1';
+	}
+	return s;
+}
+
+BigInt BigInt::div2() const {
+	BigInt res(*this);
+	shiftRightInPlace(res.digits, 1);
 	res.clearNumber();
 	return res;
 }
 
-BigInt BigInt::mod2() {
-	return (digits[0] % 2) * (isNegative ? -1 : 1);
+BigInt BigInt::mod2() const {
+	return (int)(digits[0] & 1) * (isNegative ? -1 : 1);
 }
 
-
-BigInt operator / (BigInt bigInt1, BigInt bigInt2) {
-	if (bigInt2 == 0) {
+// quotient and remainder may alias the operands
+void divmod(const BigInt& bigInt1, const BigInt& bigInt2, BigInt& quotient, BigInt& remainder) {
+	if (bigInt2.isZero()) {
 		throw "DivisionByZero";
 	}
-	else
-		if (bigInt1 == 0) {
-			return 0;
+	bool quotientNegative = bigInt1.isNegative ^ bigInt2.isNegative;
+	bool remainderNegative = bigInt1.isNegative;
+	LimbVector q, r;
+	divModAbs(bigInt1.digits, bigInt2.digits, q, r);
+	quotient.digits = move(q);
+	quotient.isNegative = quotientNegative;
+	quotient.clearNumber();
+	remainder.digits = move(r);
+	remainder.isNegative = remainderNegative;
+	remainder.clearNumber();
+}
+
+BigInt operator / (const BigInt& bigInt1, const BigInt& bigInt2) {
+	BigInt quotient, remainder;
+	divmod(bigInt1, bigInt2, quotient, remainder);
+	return quotient;
+}
+
+BigInt operator / (BigInt&& bigInt1, const BigInt& bigInt2) {
+	bigInt1 /= bigInt2;
+	return move(bigInt1);
+}
+
+BigInt operator % (const BigInt& bigInt1, const BigInt& bigInt2) {
+	BigInt quotient, remainder;
+	divmod(bigInt1, bigInt2, quotient, remainder);
+	return remainder;
+}
+
+BigInt operator % (BigInt&& bigInt1, const BigInt& bigInt2) {
+	bigInt1 %= bigInt2;
+	return move(bigInt1);
+}
+
+// Montgomery arithmetic
+
+MontgomeryContext::MontgomeryContext(const BigInt& mod_) {
+	reset(mod_);
+}
+
+// the buffers keep their capacity, so rebinding to a modulus of the same size
+// doesn't allocate
+void MontgomeryContext::reset(const BigInt& mod_) {
+	if (mod_.isNegative || mod_ <= 1 || (mod_.digits[0] & 1) == 0) {
+		throw "ValueError";
+	}
+	mod = mod_.digits;
+	n = (int)mod.size();
+
+	// Newton iteration for m^-1 mod 2^64, every step doubles the correct low bits
+	limb_t inv = mod[0];
+	for (int i = 0; i < 5; i++)
+		inv *= 2 - mod[0] * inv;
+	mInv = (limb_t)0 - inv;
+
+	// R^2 mod m, computed once by long division
+	LimbVector rr(2 * n + 1, 0), q;
+	rr[2 * n] = 1;
+	divModAbs(rr, mod, q, r2);
+	r2.resize(n, 0);
+	scratch.assign(n + 2, 0);
+	wide.assign(2 * n + 1, 0);
+	lhs.assign(n, 0);
+	rhs.assign(n, 0);
+	prod.assign(n, 0);
+}
+
+// coarsely integrated operand scanning: res = a * b * R^-1 mod m, all n limbs
+void MontgomeryContext::montMul(const limb_t* a, const limb_t* b, limb_t* res) {
+	limb_t* t = scratch.data();
+	fill(t, t + n + 2, 0);
+	for (int i = 0; i < n; i++) {
+		limb_t c = 0;
+		for (int j = 0; j < n; j++) {
+			dlimb_t cur = (dlimb_t)a[j] * b[i] + t[j] + c;
+			t[j] = (limb_t)cur;
+			c = (limb_t)(cur >> 64);
 		}
-		else
-			if (bigInt2.abs() == 1) {
-				return bigInt1 * bigInt2;
+		dlimb_t top = (dlimb_t)t[n] + c;
+		t[n] = (limb_t)top;
+		t[n + 1] = (limb_t)(top >> 64);
+
+		limb_t m = t[0] * mInv;
+		dlimb_t cur = (dlimb_t)m * mod[0] + t[0];
+		c = (limb_t)(cur >> 64);
+		for (int j = 1; j < n; j++) {
+			cur = (dlimb_t)m * mod[j] + t[j] + c;
+			t[j - 1] = (limb_t)cur;
+			c = (limb_t)(cur >> 64);
+		}
+		top = (dlimb_t)t[n] + c;
+		t[n - 1] = (limb_t)top;
+		t[n] = t[n + 1] + (limb_t)(top >> 64);
+	}
+
+	finalSubtract(t, res);
+}
+
+// Montgomery reduction of a 2n-limb t (with a spare top limb): res = t * R^-1 mod m
+void MontgomeryContext::montReduce(limb_t* t, limb_t* res) {
+	for (int i = 0; i < n; i++) {
+		limb_t m = t[i] * mInv;
+		limb_t c = 0;
+		for (int j = 0; j < n; j++) {
+			dlimb_t cur = (dlimb_t)m * mod[j] + t[i + j] + c;
+			t[i + j] = (limb_t)cur;
+			c = (limb_t)(cur >> 64);
+		}
+		for (int k = i + n; c; k++) {
+			dlimb_t cur = (dlimb_t)t[k] + c;
+			t[k] = (limb_t)cur;
+			c = (limb_t)(cur >> 64);
+		}
+	}
+	finalSubtract(t + n, res);
+}
+
+// res = a^2 * R^-1 mod m, the square itself goes through the squaring kernels
+void MontgomeryContext::montSqr(const limb_t* a, limb_t* res) {
+	limb_t* t = wide.data();
+	if (n < SQR_KARATSUBA_THRESHOLD) {
+		sqrSchoolbook(a, n, t);
+	}
+	else {
+		vector<limb_t> sq = sqrLimbs(a, n);
+		copy(sq.begin(), sq.end(), t);
+	}
+	t[2 * n] = 0;
+	montReduce(t, res);
+}
+
+// t has n + 1 limbs and is below 2m, one conditional subtraction brings it into [0, m)
+void MontgomeryContext::finalSubtract(limb_t* t, limb_t* res) {
+	bool geq = t[n] != 0;
+	if (!geq) {
+		geq = true;
+		for (int i = n - 1; i >= 0; i--) {
+			if (t[i] != mod[i]) {
+				geq = t[i] > mod[i];
+				break;
 			}
-			else
-				if (bigInt2 == 2) {
-					return bigInt1.div2();
+		}
+	}
+	if (geq) {
+		limb_t borrow = 0;
+		for (int i = 0; i < n; i++)
+			t[i] = subBorrow(t[i], mod[i], borrow);
+	}
+	copy(t, t + n, res);
+}
+
+void MontgomeryContext::padded(const BigInt& a, vector<limb_t>& out) {
+	out.assign(n, 0);
+	copy(a.digits.begin(), a.digits.begin() + min((int)a.digits.size(), n), out.begin());
+}
+
+BigInt MontgomeryContext::fromLimbs(const limb_t* res) {
+	BigInt r;
+	storeLimbs(res, r);
+	return r;
+}
+
+void MontgomeryContext::storeLimbs(const limb_t* res, BigInt& out) {
+	out.digits.assign(res, res + n);
+	out.isNegative = false;
+	out.removeLeadingZeros();
+}
+
+BigInt MontgomeryContext::getModulus() const {
+	BigInt m;
+	m.digits = mod;
+	return m;
+}
+
+BigInt MontgomeryContext::toMontgomery(const BigInt& a) {
+	padded(a.mathMod(getModulus()), lhs);
+	montMul(lhs.data(), r2.data(), prod.data());
+	return fromLimbs(prod.data());
+}
+
+// a * R^-1 is a Montgomery reduction of a on its own, no product with 1 needed
+BigInt MontgomeryContext::fromMontgomery(const BigInt& a) {
+	fill(wide.begin(), wide.end(), 0);
+	copy(a.digits.begin(), a.digits.begin() + min((int)a.digits.size(), n), wide.begin());
+	montReduce(wide.data(), prod.data());
+	return fromLimbs(prod.data());
+}
+
+BigInt MontgomeryContext::one() {
+	return toMontgomery(1);
+}
+
+BigInt MontgomeryContext::mul(const BigInt& a, const BigInt& b) {
+	padded(a, lhs);
+	padded(b, rhs);
+	montMul(lhs.data(), rhs.data(), prod.data());
+	return fromLimbs(prod.data());
+}
+
+BigInt MontgomeryContext::square(const BigInt& a) {
+	padded(a, lhs);
+	montSqr(lhs.data(), prod.data());
+	return fromLimbs(prod.data());
+}
+
+// the operands are copied into lhs/rhs first, so acc and b may be the same value
+void MontgomeryContext::mulInPlace(BigInt& acc, const BigInt& b) {
+	padded(acc, lhs);
+	padded(b, rhs);
+	montMul(lhs.data(), rhs.data(), prod.data());
+	storeLimbs(prod.data(), acc);
+}
+
+void MontgomeryContext::squareInPlace(BigInt& acc) {
+	padded(acc, lhs);
+	montSqr(lhs.data(), prod.data());
+	storeLimbs(prod.data(), acc);
+}
+
+// base^n mod m for an ordinary (non-Montgomery) base, result is ordinary too
+BigInt MontgomeryContext::modexp(const BigInt& base, const BigInt& e) {
+	return fromMontgomery(modexpToMontgomery(base, e));
+}
+
+// same power left in the Montgomery domain, for callers that keep multiplying
+BigInt MontgomeryContext::modexpToMontgomery(const BigInt& base, const BigInt& e) {
+	if (e < 0) {
+		throw "ValueError";
+	}
+	if (e.isZero()) {
+		return one();
+	}
+	vector<limb_t> b, tmp(n);
+	BigInt baseM = toMontgomery(base);
+	padded(baseM, b);
+	vector<limb_t> acc = slidingWindowPow(b, e.digits,
+		[this, &tmp](vector<limb_t>& acc, const vector<limb_t>& x) {
+			montMul(acc.data(), x.data(), tmp.data());
+			acc.swap(tmp);
+		},
+		[this, &tmp](vector<limb_t>& acc) {
+			montSqr(acc.data(), tmp.data());
+			acc.swap(tmp);
+		});
+	return fromLimbs(acc.data());
+}
+
+// Barrett arithmetic
+
+// limbs of m from which the two half products are done as whole subquadratic ones
+static const int BARRETT_FULL_PRODUCT_THRESHOLD = 800;
+
+BarrettContext::BarrettContext(const BigInt& mod_) {
+	if (mod_ <= 0) {
+		throw "ValueError";
+	}
+	mod = mod_.digits;
+	n = (int)mod.size();
+
+	// floor(b^2n / m) = floor(4^B / (m * 2^t)) for t = 2 * 64n - 2 * bits and
+	// B = bits + t, so reciprocal() applies
+	int bits = mod_.bitLength();
+	int t = 2 * BigInt::LIMB_BITS * n - 2 * bits;
+	BigInt recip = reciprocal(mod_ << t, bits + t);
+	mu.assign(n + 1, 0);
+	if ((int)recip.digits.size() > n + 1) {
+		// m = b^(n - 1) gives mu = b^(n + 1); one below only costs a correction
+		fill(mu.begin(), mu.end(), ~(limb_t)0);
+	}
+	else {
+		copy(recip.digits.begin(), recip.digits.end(), mu.begin());
+	}
+	scratch.assign(3 * n + 3, 0);
+	wide.assign(2 * n, 0);
+}
+
+// res = x mod m for x of 2n limbs. q = floor(floor(x / b^(n-1)) * mu / b^(n+1))
+// is at most a few below x / m, so x - q * m fits n + 1 limbs and only the low
+// half of q * m and the high half of the first product are needed.
+void BarrettContext::reduceLimbs(const limb_t* x, limb_t* res) {
+	const limb_t* q1 = x + n - 1;
+	limb_t* t = scratch.data();
+	limb_t* r = t + 2 * n + 2;
+	if (n < BARRETT_FULL_PRODUCT_THRESHOLD) {
+		// columns below n - 1 are skipped, they only lose carries
+		fill(t, t + 2 * n + 2, 0);
+		for (int i = 0; i <= n; i++) {
+			limb_t carry = 0;
+			for (int j = max(0, n - 1 - i); j <= n; j++) {
+				dlimb_t cur = (dlimb_t)q1[i] * mu[j] + t[i + j] + carry;
+				t[i + j] = (limb_t)cur;
+				carry = (limb_t)(cur >> 64);
+			}
+			t[i + n + 1] = carry;
+		}
+	}
+	else {
+		vector<limb_t> p = mulLimbs(q1, n + 1, mu.data(), n + 1);
+		copy(p.begin(), p.end(), t);
+	}
+	const limb_t* q = t + n + 1;
+
+	if (n < BARRETT_FULL_PRODUCT_THRESHOLD) {
+		fill(r, r + n + 1, 0);
+		for (int i = 0; i <= n; i++) {
+			limb_t carry = 0;
+			for (int j = 0; j < n && i + j <= n; j++) {
+				dlimb_t cur = (dlimb_t)q[i] * mod[j] + r[i + j] + carry;
+				r[i + j] = (limb_t)cur;
+				carry = (limb_t)(cur >> 64);
+			}
+			if (i == 0)
+				r[n] = carry;
+		}
+	}
+	else {
+		vector<limb_t> p = mulLimbs(q, n + 1, mod.data(), n);
+		copy(p.begin(), p.begin() + n + 1, r);
+	}
+
+	// r = x - q * m mod b^(n+1), then the remaining multiples of m
+	limb_t borrow = 0;
+	for (int i = 0; i <= n; i++)
+		r[i] = subBorrow(x[i], r[i], borrow);
+	while (true) {
+		bool geq = r[n] != 0;
+		if (!geq) {
+			geq = true;
+			for (int i = n - 1; i >= 0; i--) {
+				if (r[i] != mod[i]) {
+					geq = r[i] > mod[i];
+					break;
 				}
-				else
-					if (bigInt1 < 0 || bigInt2 < 0) {
-						return (bigInt1.abs() / bigInt2.abs()) * (bigInt1.isNegative ^ bigInt2.isNegative ? -1 : 1);
-					}
-					else {
-						BigInt bigInt2Power2 = bigInt2;
-						BigInt power2(1);
-						while (bigInt2Power2 < bigInt1) {
-							bigInt2Power2 = bigInt2Power2 * 2;
-							power2 = power2 * 2;
-						}
-						BigInt tmp;
-						BigInt res;
-						while (power2 > 0) {
-							if (tmp + bigInt2Power2 <= bigInt1) {
-								tmp = tmp + bigInt2Power2;
-								res = res + power2;
-							}
-							bigInt2Power2 = bigInt2Power2 / 2;
-							power2 = power2 / 2;
-						}
-						return res;
-					}
+			}
+		}
+		if (!geq)
+			break;
+		borrow = 0;
+		for (int i = 0; i < n; i++)
+			r[i] = subBorrow(r[i], mod[i], borrow);
+		r[n] -= borrow;
+	}
+	copy(r, r + n, res);
+}
 
+void BarrettContext::mulLimbsMod(const limb_t* a, const limb_t* b, limb_t* res) {
+	limb_t* t = wide.data();
+	if (n < KARATSUBA_THRESHOLD) {
+		mulSchoolbook(a, n, b, n, t);
+	}
+	else {
+		vector<limb_t> p = mulLimbs(a, n, b, n);
+		copy(p.begin(), p.end(), t);
+	}
+	reduceLimbs(t, res);
+}
 
+void BarrettContext::sqrLimbsMod(const limb_t* a, limb_t* res) {
+	limb_t* t = wide.data();
+	if (n < SQR_KARATSUBA_THRESHOLD) {
+		sqrSchoolbook(a, n, t);
+	}
+	else {
+		vector<limb_t> p = sqrLimbs(a, n);
+		copy(p.begin(), p.end(), t);
+	}
+	reduceLimbs(t, res);
 }
 
-BigInt operator / (BigInt bigInt1, int int2) {
-	return bigInt1 / BigInt(int2);
+BigInt BarrettContext::fromLimbs(const limb_t* res) {
+	BigInt r;
+	r.digits.assign(res, res + n);
+	r.removeLeadingZeros();
+	return r;
+}
+
+BigInt BarrettContext::getModulus() const {
+	BigInt m;
+	m.digits = mod;
+	return m;
+}
+
+BigInt BarrettContext::reduce(const BigInt& x) {
+	if (x.isNegative || (int)x.digits.size() > 2 * n)
+		return x.mathMod(getModulus());
+	if ((int)x.digits.size() < n)
+		return x;
+	fill(wide.begin(), wide.end(), 0);
+	copy(x.digits.begin(), x.digits.end(), wide.begin());
+	vector<limb_t> res(n);
+	reduceLimbs(wide.data(), res.data());
+	return fromLimbs(res.data());
+}
+
+BigInt BarrettContext::mul(const BigInt& a, const BigInt& b) {
+	return reduce(a * b);
+}
+
+BigInt BarrettContext::square(const BigInt& a) {
+	return reduce(a.square());
+}
+
+// base^n mod m, every product is reduced in place on n-limb buffers
+BigInt BarrettContext::modexp(const BigInt& base, const BigInt& e) {
+	if (e < 0) {
+		throw "ValueError";
+	}
+	if (e.isZero()) {
+		return reduce(1);
+	}
+	BigInt b0 = reduce(base);
+	vector<limb_t> b(n, 0), tmp(n);
+	copy(b0.digits.begin(), b0.digits.end(), b.begin());
+	vector<limb_t> acc = slidingWindowPow(b, e.digits,
+		[this, &tmp](vector<limb_t>& acc, const vector<limb_t>& x) {
+			mulLimbsMod(acc.data(), x.data(), tmp.data());
+			acc.swap(tmp);
+		},
+		[this, &tmp](vector<limb_t>& acc) {
+			sqrLimbsMod(acc.data(), tmp.data());
+			acc.swap(tmp);
+		});
+	return fromLimbs(acc.data());
+}
+
+// Modulus
+
+Modulus::Modulus(const BigInt& m_) : m(m_) {
+	if (m <= 0) {
+		throw "ValueError";
+	}
+}
+
+// Montgomery for powers modulo odd m, Barrett for products and for powers
+// modulo even m, plain division while m fits a limb
+bool Modulus::useMontgomery() const {
+	return m > 1 && m.testBit(0);
+}
+
+bool Modulus::useBarrett() const {
+	return (int)m.getDigits().size() >= BARRETT_MIN_LIMBS;
+}
+
+MontgomeryContext& Modulus::montgomery() {
+	if (!mont)
+		mont.reset(new MontgomeryContext(m));
+	return *mont;
+}
+
+BarrettContext& Modulus::barrett() {
+	if (!barr)
+		barr.reset(new BarrettContext(m));
+	return *barr;
+}
+
+const BigInt& Modulus::value() const {
+	return m;
+}
+
+// operands are reduced once per call, so Barrett is only worth it here when
+// mul or pow already built the context
+BigInt Modulus::reduce(const BigInt& a) {
+	if (a >= 0 && a < m)
+		return a;
+	if (barr)
+		return barr->reduce(a);
+	return a.mathMod(m);
+}
+
+// residues stay below m, so one conditional correction replaces the %
+BigInt Modulus::add(const BigInt& a, const BigInt& b) const {
+	BigInt res = a + b;
+	if (res >= m)
+		res -= m;
+	return res;
+}
+
+BigInt Modulus::sub(const BigInt& a, const BigInt& b) const {
+	BigInt res = a - b;
+	if (res < 0)
+		res += m;
+	return res;
+}
+
+// a single product of ordinary residues would need two Montgomery passes to
+// get back out of the domain, a Barrett reduction of the product is cheaper
+BigInt Modulus::mul(const BigInt& a, const BigInt& b) {
+	if (useBarrett())
+		return barrett().reduce(a * b);
+	return (a * b).mathMod(m);
+}
+
+BigInt Modulus::square(const BigInt& a) {
+	if (useBarrett())
+		return barrett().reduce(a.square());
+	return a.square().mathMod(m);
+}
+
+BigInt Modulus::inverse(const BigInt& a) const {
+	return a.reversedBySimpleMod(m);
+}
+
+BigInt Modulus::div(const BigInt& a, const BigInt& b) {
+	return mul(a, inverse(b));
+}
+
+BigInt Modulus::pow(const BigInt& a, const BigInt& n) {
+	if (n < 0)
+		return pow(inverse(a), -n);
+	if (m == 1)
+		return 0;
+	if (useMontgomery())
+		return montgomery().modexp(a, n);
+	if (useBarrett())
+		return barrett().modexp(a, n);
+	return a.pow(n, m);
+}
+
+BigInt BigInt::addBySimpleMod(const BigInt& other, Modulus& mod) const {
+	return mod.add(mod.reduce(*this), mod.reduce(other));
+}
+
+BigInt BigInt::subBySimpleMod(const BigInt& other, Modulus& mod) const {
+	return mod.sub(mod.reduce(*this), mod.reduce(other));
+}
+
+BigInt BigInt::mulBySimpleMod(const BigInt& other, Modulus& mod) const {
+	return mod.mul(mod.reduce(*this), mod.reduce(other));
+}
+
+BigInt BigInt::divBySimpleMod(const BigInt& other, Modulus& mod) const {
+	return mod.div(mod.reduce(*this), mod.reduce(other));
+}
+
+BigInt BigInt::powBySimpleMod(const BigInt& n, Modulus& mod) const {
+	return mod.pow(mod.reduce(*this), n);
+}
+
+// one-off versions: a Modulus only pays off when its data is reused, so these
+// keep to a single sum or product and %
+BigInt BigInt::addBySimpleMod(const BigInt& other, const BigInt& mod) const {
+	if (mod <= 0) {
+		throw "ValueError";
+	}
+	return (*this + other).mathMod(mod);
+}
+
+BigInt BigInt::subBySimpleMod(const BigInt& other, const BigInt& mod) const {
+	if (mod <= 0) {
+		throw "ValueError";
+	}
+	return (*this - other).mathMod(mod);
+}
+
+BigInt BigInt::mulBySimpleMod(const BigInt& other, const BigInt& mod) const {
+	if (mod <= 0) {
+		throw "ValueError";
+	}
+	return (*this * other).mathMod(mod);
+}
+
+BigInt BigInt::divBySimpleMod(const BigInt& other, const BigInt& mod) const {
+	return mulBySimpleMod(other.reversedBySimpleMod(mod), mod);
+}
+
+BigInt BigInt::powBySimpleMod(const BigInt& n, const BigInt& mod) const {
+	if (mod <= 0) {
+		throw "ValueError";
+	}
+	if (n < 0)
+		return reversedBySimpleMod(mod).pow(-n, mod).mathMod(mod);
+	return pow(n, mod).mathMod(mod);
+}
+
+BigInt test_FastPow_Mod(BigInt b, BigInt n, BigInt m) {
+	return(b.pow(n) % m);
+}
+
+BigInt karatsuba(const BigInt& first, const BigInt& second) {
+	const LimbVector& a = first.getDigits();
+	const LimbVector& b = second.getDigits();
+	BigInt res(mulKaratsuba(a.data(), (int)a.size(), b.data(), (int)b.size()), (first < 0) ^ (second < 0));
+	res.clearNumber();
+	return res;
+}
+
+// small prime trial division
+//
+// The odd primes below 2^16 and their products, packed greedily into 64-bit
+// words, are built at compile time. n is tested with one word remainder and one
+// word gcd per product; only a product that shares a factor with n is looked at
+// prime by prime.
+
+static const int SMALL_PRIME_LIMIT = 1 << 16;
+// trial division bound of the probable prime tests
+static const int PRIME_TEST_TRIAL_BOUND = 2048;
+
+struct SmallPrimeTable {
+	uint32_t primes[6542];
+	int count;
+	uint64_t products[6542];
+	// products[g] covers primes[first[g]] .. primes[first[g + 1] - 1]
+	int first[6543];
+	int groups;
+};
+
+static constexpr SmallPrimeTable makeSmallPrimeTable() {
+	SmallPrimeTable t{};
+	bool composite[SMALL_PRIME_LIMIT] = {};
+	for (uint32_t p = 3; p < (uint32_t)SMALL_PRIME_LIMIT; p += 2) {
+		if (composite[p])
+			continue;
+		t.primes[t.count++] = p;
+		for (uint32_t q = p * p; q < (uint32_t)SMALL_PRIME_LIMIT; q += 2 * p)
+			composite[q] = true;
+	}
+	for (int i = 0; i < t.count; ) {
+		uint64_t product = 1;
+		t.first[t.groups] = i;
+		while (i < t.count && product <= ~(uint64_t)0 / t.primes[i])
+			product *= t.primes[i++];
+		t.products[t.groups++] = product;
+	}
+	t.first[t.groups] = t.count;
+	return t;
+}
+
+static constexpr SmallPrimeTable SMALL_PRIMES = makeSmallPrimeTable();
+static_assert(SMALL_PRIMES.count == 6541, "odd primes below 2^16");
+
+static limb_t gcdWord(limb_t a, limb_t b);
+
+bool hasSmallFactor(const BigInt& n, int bound) {
+	if (bound > SMALL_PRIME_LIMIT) {
+		throw "ValueError";
+	}
+	const LimbVector& d = n.getDigits();
+	if (bound < 2 || (d.size() == 1 && d[0] <= 1))
+		return n.isZero() && bound >= 2;
+	if (!n.testBit(0))
+		return !(d.size() == 1 && d[0] == 2);
+	for (int g = 0; g < SMALL_PRIMES.groups; g++) {
+		if (SMALL_PRIMES.primes[SMALL_PRIMES.first[g]] > (uint32_t)bound)
+			break;
+		limb_t product = SMALL_PRIMES.products[g];
+		limb_t r = (n % product).getDigits()[0];
+		if (gcdWord(r, product) == 1)
+			continue;
+		for (int i = SMALL_PRIMES.first[g]; i < SMALL_PRIMES.first[g + 1]; i++) {
+			uint32_t p = SMALL_PRIMES.primes[i];
+			if (p > (uint32_t)bound)
+				break;
+			if (r % p == 0 && !(d.size() == 1 && d[0] == p))
+				return true;
+		}
+	}
+	return false;
+}
+
+// random numbers
+//
+// ChaCha20 keystream (DJB layout: 64-bit block counter in words 12-13, stream
+// number in 14-15), produced 8 blocks at a time; the AVX2 kernel computes the
+// 8 blocks in parallel with one block per 32-bit lane.
+
+static const int CHACHA_BATCH = 8;
+static const size_t CHACHA_BATCH_BYTES = 64 * CHACHA_BATCH;
+
+typedef void (*ChaChaKernel)(const uint32_t* state, uint8_t* out);
+
+static inline uint32_t rotl32(uint32_t x, int n) {
+	return (x << n) | (x >> (32 - n));
+}
+
+#define CHACHA_QUARTER(a, b, c, d) \
+	a += b; d = rotl32(d ^ a, 16); \
+	c += d; b = rotl32(b ^ c, 12); \
+	a += b; d = rotl32(d ^ a, 8); \
+	c += d; b = rotl32(b ^ c, 7);
+
+static void chachaBlocksScalar(const uint32_t* state, uint8_t* out) {
+	uint64_t counter = state[12] | (uint64_t)state[13] << 32;
+	for (int b = 0; b < CHACHA_BATCH; b++) {
+		uint32_t in[16], x[16];
+		memcpy(in, state, sizeof(in));
+		in[12] = (uint32_t)(counter + b);
+		in[13] = (uint32_t)((counter + b) >> 32);
+		memcpy(x, in, sizeof(x));
+		for (int i = 0; i < 10; i++) {
+			CHACHA_QUARTER(x[0], x[4], x[8], x[12]);
+			CHACHA_QUARTER(x[1], x[5], x[9], x[13]);
+			CHACHA_QUARTER(x[2], x[6], x[10], x[14]);
+			CHACHA_QUARTER(x[3], x[7], x[11], x[15]);
+			CHACHA_QUARTER(x[0], x[5], x[10], x[15]);
+			CHACHA_QUARTER(x[1], x[6], x[11], x[12]);
+			CHACHA_QUARTER(x[2], x[7], x[8], x[13]);
+			CHACHA_QUARTER(x[3], x[4], x[9], x[14]);
+		}
+		for (int i = 0; i < 16; i++) {
+			uint32_t w = x[i] + in[i];
+			for (int j = 0; j < 4; j++)
+				out[64 * b + 4 * i + j] = (uint8_t)(w >> (8 * j));
+		}
+	}
 }
 
-BigInt operator / (int int1, BigInt bigInt2) {
-	return BigInt(int1) / bigInt2;
-}
+#if defined(__x86_64__) || defined(__i386__)
 
+#define CHACHA_ROTL_AVX2(x, n) _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n))
+#define CHACHA_QUARTER_AVX2(a, b, c, d) \
+	a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16); \
+	c = _mm256_add_epi32(c, d); b = CHACHA_ROTL_AVX2(_mm256_xor_si256(b, c), 12); \
+	a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot8); \
+	c = _mm256_add_epi32(c, d); b = CHACHA_ROTL_AVX2(_mm256_xor_si256(b, c), 7);
 
-BigInt operator % (BigInt bigInt1, BigInt bigInt2) {
-	if (bigInt2 == 0) {
-		throw "DivisionByZero";
+// rows v[0..7] hold word k of blocks 0..7; afterwards v[j] holds words 0..7 of block
+// j (j < 4) in order, and of block j + 4 for the high 128-bit halves of v[j + 4]
+__attribute__((target("avx2")))
+static void chachaTranspose(__m256i* v) {
+	__m256i t[8], u[8];
+	for (int i = 0; i < 8; i += 2) {
+		t[i] = _mm256_unpacklo_epi32(v[i], v[i + 1]);
+		t[i + 1] = _mm256_unpackhi_epi32(v[i], v[i + 1]);
 	}
-	else
-		if (bigInt1 == 0 || bigInt2.abs() == 1) {
-			return 0;
-		}
-		else
-			if (bigInt2 == 2) {
-				return bigInt1.mod2();
-			}
-			else
-				if (bigInt1 < 0 || bigInt2 < 0) {
-					return (bigInt1.abs() % bigInt2.abs()) * (bigInt1.isNegative ? -1 : 1);
-				}
-				else {
-					BigInt bigInt2Power2 = bigInt2;
-					BigInt power2(1);
-					while (bigInt2Power2 < bigInt1) {
-						bigInt2Power2 = bigInt2Power2 * 2;
-						power2 = power2 * 2;
-					}
-					BigInt tmp;
-					BigInt res;
-					while (power2 > 0) {
-						if (tmp + bigInt2Power2 <= bigInt1) {
-							tmp = tmp + bigInt2Power2;
-							res = res + power2;
-						}
-						bigInt2Power2 = bigInt2Power2 / 2;
-						power2 = power2 / 2;
-					}
-					return bigInt1 - tmp;
-				}
-
+	for (int i = 0; i < 8; i += 4) {
+		u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+		u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+		u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+		u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+	}
+	for (int i = 0; i < 4; i++) {
+		v[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+		v[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+	}
+}
+
+__attribute__((target("avx2")))
+static void chachaBlocksAvx2(const uint32_t* state, uint8_t* out) {
+	const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+		2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+	const __m256i rot8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+		3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+	uint64_t counter = state[12] | (uint64_t)state[13] << 32;
+	uint32_t lo[8], hi[8];
+	for (int b = 0; b < 8; b++) {
+		lo[b] = (uint32_t)(counter + b);
+		hi[b] = (uint32_t)((counter + b) >> 32);
+	}
+	__m256i in[16], x[16];
+	for (int i = 0; i < 16; i++)
+		in[i] = _mm256_set1_epi32((int)state[i]);
+	in[12] = _mm256_loadu_si256((const __m256i*)lo);
+	in[13] = _mm256_loadu_si256((const __m256i*)hi);
+	for (int i = 0; i < 16; i++)
+		x[i] = in[i];
+	for (int i = 0; i < 10; i++) {
+		CHACHA_QUARTER_AVX2(x[0], x[4], x[8], x[12]);
+		CHACHA_QUARTER_AVX2(x[1], x[5], x[9], x[13]);
+		CHACHA_QUARTER_AVX2(x[2], x[6], x[10], x[14]);
+		CHACHA_QUARTER_AVX2(x[3], x[7], x[11], x[15]);
+		CHACHA_QUARTER_AVX2(x[0], x[5], x[10], x[15]);
+		CHACHA_QUARTER_AVX2(x[1], x[6], x[11], x[12]);
+		CHACHA_QUARTER_AVX2(x[2], x[7], x[8], x[13]);
+		CHACHA_QUARTER_AVX2(x[3], x[4], x[9], x[14]);
+	}
+	for (int i = 0; i < 16; i++)
+		x[i] = _mm256_add_epi32(x[i], in[i]);
+	chachaTranspose(x);
+	chachaTranspose(x + 8);
+	for (int b = 0; b < 4; b++) {
+		_mm256_storeu_si256((__m256i*)(out + 64 * b), x[b]);
+		_mm256_storeu_si256((__m256i*)(out + 64 * b + 32), x[b + 8]);
+		_mm256_storeu_si256((__m256i*)(out + 64 * (b + 4)), x[b + 4]);
+		_mm256_storeu_si256((__m256i*)(out + 64 * (b + 4) + 32), x[b + 12]);
+	}
+}
+
+static ChaChaKernel selectChaChaKernel() {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return chachaBlocksAvx2;
+	return chachaBlocksScalar;
+}
+
+#else
+
+static ChaChaKernel selectChaChaKernel() {
+	return chachaBlocksScalar;
+}
+
+#endif
+
+static ChaChaKernel chachaKernel() {
+	static const ChaChaKernel kernel = selectChaChaKernel();
+	return kernel;
+}
+
+ChaChaRandom::ChaChaRandom() {
+	random_device device;
+	uint8_t key[32];
+	for (int i = 0; i < 32; i += 4) {
+		uint32_t w = device();
+		memcpy(key + i, &w, 4);
+	}
+	setKey(key, 0);
+}
+
+ChaChaRandom::ChaChaRandom(uint64_t seed) {
+	// splitmix64 spreads the seed over the key
+	uint8_t key[32];
+	for (int i = 0; i < 32; i += 8) {
+		seed += 0x9e3779b97f4a7c15ULL;
+		uint64_t z = seed;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		z ^= z >> 31;
+		memcpy(key + i, &z, 8);
+	}
+	setKey(key, 0);
+}
+
+ChaChaRandom::ChaChaRandom(const uint8_t* key, uint64_t stream) {
+	setKey(key, stream);
+}
+
+void ChaChaRandom::setKey(const uint8_t* key, uint64_t stream) {
+	static const uint32_t sigma[4] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+	for (int i = 0; i < 4; i++)
+		state[i] = sigma[i];
+	for (int i = 0; i < 8; i++)
+		state[4 + i] = key[4 * i] | (uint32_t)key[4 * i + 1] << 8 | (uint32_t)key[4 * i + 2] << 16 | (uint32_t)key[4 * i + 3] << 24;
+	state[12] = state[13] = 0;
+	state[14] = (uint32_t)stream;
+	state[15] = (uint32_t)(stream >> 32);
+	pos = CHACHA_BATCH_BYTES;
+}
+
+ChaChaRandom& ChaChaRandom::local() {
+	thread_local ChaChaRandom generator;
+	return generator;
+}
+
+void ChaChaRandom::advance() {
+	uint64_t counter = (state[12] | (uint64_t)state[13] << 32) + CHACHA_BATCH;
+	state[12] = (uint32_t)counter;
+	state[13] = (uint32_t)(counter >> 32);
+}
 
+void ChaChaRandom::fill(uint8_t* out, size_t len) {
+	while (len > 0) {
+		if (pos == CHACHA_BATCH_BYTES) {
+			// whole batches go straight to the caller
+			if (len >= CHACHA_BATCH_BYTES) {
+				chachaKernel()(state, out);
+				advance();
+				out += CHACHA_BATCH_BYTES;
+				len -= CHACHA_BATCH_BYTES;
+				continue;
+			}
+			chachaKernel()(state, buffer);
+			advance();
+			pos = 0;
+		}
+		size_t part = min(len, CHACHA_BATCH_BYTES - pos);
+		memcpy(out, buffer + pos, part);
+		pos += part;
+		out += part;
+		len -= part;
+	}
 }
 
-BigInt operator % (BigInt bigInt1, int int2) {
-	return bigInt1 % BigInt(int2);
+void ChaChaRandom::fill(limb_t* out, size_t count) {
+	fill((uint8_t*)out, count * sizeof(limb_t));
 }
 
-BigInt operator % (int int1, BigInt bigInt2) {
-	return BigInt(int1) % bigInt2;
+limb_t ChaChaRandom::next() {
+	limb_t x;
+	fill(&x, 1);
+	return x;
 }
 
-
-
-BigInt test_FastPow_Mod(BigInt b, BigInt n, BigInt m) {
-	return(b.pow(n) % m);
+BigInt ChaChaRandom::below(const BigInt& bound) {
+	if (bound <= 0) {
+		throw "ValueError";
+	}
+	// draws of bitLength(bound) bits are accepted with probability > 1/2
+	int bits = bound.bitLength();
+	int len = (bits + 63) / 64;
+	limb_t mask = bits % 64 == 0 ? ~(limb_t)0 : ((limb_t)1 << (bits % 64)) - 1;
+	while (true) {
+		LimbVector digits(len);
+		fill(digits.data(), len);
+		digits[len - 1] &= mask;
+		BigInt x(move(digits), false);
+		if (x < bound)
+			return x;
+	}
 }
 
-BigInt karatsuba(BigInt first, BigInt second) {
-	if (first.getLength() % 2 != 0 || second.getLength() % 2 != 0)
-		throw "Both numbers must have even number of digits";
-	if (first.getLength() != second.getLength())
-		throw "Nubmers have different size!";
-	
-	int x = first.getLength() / 2;
-	BigInt a = first / x;
-	BigInt b = first % x;
-	BigInt c = second / x;
-	BigInt d = second % x;
-
-	BigInt a_m_c = a * c;
-	BigInt b_m_d = b * d;
-	
-	return a_m_c * x * x + ((a + b) * (c + d) - a_m_c - b_m_d) * x + b_m_d;
+BigInt randBigInt(const BigInt& bound) {
+	return ChaChaRandom::local().below(bound);
 }
 
-BigInt randBigInt(BigInt p) {
-	int len = p.getLength();
-	vector<int> digits(len);
-	for (int i = 0; i + 1 < len; i++) {
-		digits[i] = rand() % BigInt::BASE;
+// one Miller-Rabin round for odd n - 1 = t * 2^s; one and minusOne are 1 and
+// n - 1 in the Montgomery domain of ctx. A set cancel flag ends the squarings
+// early, the result is then meaningless.
+static bool millerRabinRound(MontgomeryContext& ctx, const BigInt& a, const BigInt& t, int s,
+	const BigInt& one, const BigInt& minusOne, const atomic<bool>* cancel = nullptr) {
+	BigInt x = ctx.modexpToMontgomery(a, t);
+	if (x == one || x == minusOne)
+		return true;
+	for (int j = 0; j < s - 1; j++) {
+		if (cancel && cancel->load(memory_order_relaxed))
+			return true;
+		ctx.squareInPlace(x);
+		if (x == one)
+			return false;
+		if (x == minusOne)
+			return true;
 	}
-	auto pDigits = p.getDigits();
-	digits[len - 1] = rand() % pDigits[len - 1];
-	return BigInt(digits, false);
+	return false;
 }
 
-bool MillerRabinTest(BigInt n, int k) {
+// k random rounds; ctx is created or rebound to n, so a caller testing many
+// numbers reuses its buffers
+static bool millerRabinTest(unique_ptr<MontgomeryContext>& ctx, const BigInt& n, int k) {
 	if (n == 2 || n == 3)
 		return true;
-	if (n < 2 || n % 2 == 0)
+	if (n < 2 || n % 2 == 0 || hasSmallFactor(n, PRIME_TEST_TRIAL_BOUND))
 		return false;
 
 	BigInt t = n - 1;
-	int s = 0;
-	while (t % 2 == 0) {
-		t = t.div2();
-		s++;
-	}
+	int s = t.lowestSetBit();
+	t >>= s;
+
+	// one context for all rounds, squarings stay in the Montgomery domain
+	if (ctx)
+		ctx->reset(n);
+	else
+		ctx.reset(new MontgomeryContext(n));
+	BigInt one = ctx->one();
+	BigInt minusOne = ctx->toMontgomery(n - 1);
 	for (int i = 0; i < k; i++) {
 		BigInt rand = randBigInt(n - 2) + 2;
-		BigInt x = rand.pow(t, n);
-
-		if (x == 1 || x == n - 1) 
-			continue;
-
-		for (int j = 0; j < s - 1; j++) {
-			x = x.pow(2, n);
-			if (x == 1)
-				return false;
-			if (x == n - 1)
-				break;
-		}
-
-		if (x != n - 1)
+		if (!millerRabinRound(*ctx, rand, t, s, one, minusOne))
 			return false;
 	}
 	return true;
 }
 
-bool MillerRabinTest_Base(BigInt n, int base) {
-	if (n < 2 || n % 2 == 0)
-		return false;
-
-	BigInt t = n - 1;
-	int s = 0;
-	while (t % 2 == 0) {
-		t = t.div2();
-		s++;
+bool MillerRabinTest(const BigInt& n, int k) {
+	unique_ptr<MontgomeryContext> ctx;
+	return millerRabinTest(ctx, n, k);
+}
+
+// thread pool
+//
+// parallelFor splits the index range evenly between the workers; a worker that
+// runs out steals the upper half of the largest remaining range, so uneven
+// tasks (candidates of different sizes, early exits) still keep every core busy.
+
+class WorkStealingPool {
+public:
+	// task(i, worker) with worker in [0, size())
+	typedef function<void(size_t, int)> Task;
+
+	explicit WorkStealingPool(int count);
+	~WorkStealingPool();
+	static WorkStealingPool& shared();
+
+	int size() const;
+	// runs task for every i in [0, count) and returns when all are done; the
+	// first exception thrown by a task is rethrown here, count <= 0 is a no-op
+	void parallelFor(long long count, const Task& task);
+private:
+	struct Range {
+		mutex lock;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+
+	vector<thread> threads;
+	vector<unique_ptr<Range>> ranges;
+	mutex jobLock;
+	mutex stateLock;
+	condition_variable wake;
+	condition_variable done;
+	const Task* task = nullptr;
+	size_t generation = 0;
+	int running = 0;
+	bool stopping = false;
+	exception_ptr error;
+
+	bool next(int id, size_t& i);
+	void workerLoop(int id);
+};
+
+WorkStealingPool::WorkStealingPool(int count) {
+	for (int i = 0; i < count; i++)
+		ranges.emplace_back(new Range());
+	for (int i = 0; i < count; i++)
+		threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+	{
+		lock_guard<mutex> guard(stateLock);
+		stopping = true;
 	}
+	wake.notify_all();
+	for (thread& th : threads)
+		th.join();
+}
 
-	BigInt a = BigInt(base);
-	BigInt k = a.pow(t, n);
+WorkStealingPool& WorkStealingPool::shared() {
+	static WorkStealingPool pool(max(1, (int)thread::hardware_concurrency()));
+	return pool;
+}
 
-	if (k == 1 || k == -1)
-		return true;
+int WorkStealingPool::size() const {
+	return (int)ranges.size();
+}
 
-	for (int i = 0; i < s - 1; i++) {
-		k = k.pow(2, n);
-		if (k == 1)
-			return false;
-		if (k == -1)
+bool WorkStealingPool::next(int id, size_t& i) {
+	Range& own = *ranges[id];
+	{
+		lock_guard<mutex> guard(own.lock);
+		if (own.begin < own.end) {
+			i = own.begin++;
 			return true;
+		}
+	}
+	while (true) {
+		int victim = -1;
+		size_t most = 0;
+		for (int v = 0; v < size(); v++) {
+			lock_guard<mutex> guard(ranges[v]->lock);
+			if (ranges[v]->end - ranges[v]->begin > most) {
+				most = ranges[v]->end - ranges[v]->begin;
+				victim = v;
+			}
+		}
+		if (victim < 0)
+			return false;
+		size_t from, to;
+		{
+			Range& r = *ranges[victim];
+			lock_guard<mutex> guard(r.lock);
+			if (r.begin >= r.end)
+				continue;
+			to = r.end;
+			from = r.begin + (r.end - r.begin) / 2;
+			r.end = from;
+		}
+		lock_guard<mutex> guard(own.lock);
+		own.begin = from + 1;
+		own.end = to;
+		i = from;
+		return true;
 	}
-	return false;
 }
 
-BigInt gcd(BigInt a, BigInt b) {
-	if (a == 0)
-		return b;
+void WorkStealingPool::workerLoop(int id) {
+	size_t seen = 0;
+	while (true) {
+		const Task* job;
+		{
+			unique_lock<mutex> guard(stateLock);
+			wake.wait(guard, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+			job = task;
+		}
+		size_t i;
+		try {
+			while (next(id, i))
+				(*job)(i, id);
+		}
+		catch (...) {
+			lock_guard<mutex> guard(stateLock);
+			if (!error)
+				error = current_exception();
+			// drop the rest of this worker's range, the others finish theirs
+			lock_guard<mutex> rangeGuard(ranges[id]->lock);
+			ranges[id]->begin = ranges[id]->end;
+		}
+		lock_guard<mutex> guard(stateLock);
+		if (--running == 0)
+			done.notify_all();
+	}
+}
+
+void WorkStealingPool::parallelFor(long long count, const Task& job) {
+	if (count <= 0)
+		return;
+	lock_guard<mutex> jobGuard(jobLock);
+	size_t total = (size_t)count;
+	size_t workers = ranges.size();
+	for (size_t w = 0; w < workers; w++) {
+		lock_guard<mutex> guard(ranges[w]->lock);
+		ranges[w]->begin = total * w / workers;
+		ranges[w]->end = total * (w + 1) / workers;
+	}
+	unique_lock<mutex> guard(stateLock);
+	task = &job;
+	error = nullptr;
+	running = (int)workers;
+	generation++;
+	wake.notify_all();
+	done.wait(guard, [this] { return running == 0; });
+	if (error)
+		rethrow_exception(error);
+}
+
+vector<bool> MillerRabinTestBatch(const vector<BigInt>& candidates, int k) {
+	WorkStealingPool& pool = WorkStealingPool::shared();
+	// one context per worker, rebound to each of its candidates
+	vector<unique_ptr<MontgomeryContext>> contexts(pool.size());
+	// vector<bool> packs bits and can't be written from several threads
+	vector<char> prime(candidates.size());
+	pool.parallelFor((long long)candidates.size(), [&](size_t i, int worker) {
+		prime[i] = millerRabinTest(contexts[worker], candidates[i], k);
+	});
+	return vector<bool>(prime.begin(), prime.end());
+}
+
+bool MillerRabinTestParallel(const BigInt& n, int k) {
+	if (n == 2 || n == 3)
+		return true;
+	if (n < 2 || n % 2 == 0 || hasSmallFactor(n, PRIME_TEST_TRIAL_BOUND))
+		return false;
+	// no rounds to run, same answer as MillerRabinTest
+	if (k <= 0)
+		return true;
 
-	else
-		return gcd(b % a, a);
-	
+	BigInt t = n - 1;
+	int s = t.lowestSetBit();
+	t >>= s;
+
+	MontgomeryContext first(n);
+	BigInt one = first.one();
+	BigInt minusOne = first.toMontgomery(n - 1);
+	WorkStealingPool& pool = WorkStealingPool::shared();
+	vector<unique_ptr<MontgomeryContext>> contexts(pool.size());
+	atomic<bool> composite(false);
+	pool.parallelFor(k, [&](size_t, int worker) {
+		// rounds not started yet are skipped once a witness is found
+		if (composite.load(memory_order_relaxed))
+			return;
+		if (!contexts[worker])
+			contexts[worker].reset(new MontgomeryContext(n));
+		BigInt rand = randBigInt(n - 2) + 2;
+		if (!millerRabinRound(*contexts[worker], rand, t, s, one, minusOne, &composite))
+			composite = true;
+	});
+	return !composite;
 }
 
-BigInt gcd(int a, BigInt b) {
-	if (a == 0)
-		return b;
+// strong probable prime test to the given base; a base divisible by n proves nothing
+bool MillerRabinTest_Base(const BigInt& n, int base) {
+	if (n == 2)
+		return true;
+	if (n < 2 || n % 2 == 0)
+		return false;
 
-	else
-		return gcd(b % a, a);
+	BigInt a = BigInt(base).mathMod(n);
+	if (a.isZero())
+		return true;
+	BigInt t = n - 1;
+	int s = t.lowestSetBit();
+	t >>= s;
+
+	MontgomeryContext ctx(n);
+	return millerRabinRound(ctx, a, t, s, ctx.one(), ctx.toMontgomery(n - 1));
+}
+
+// gcd
+//
+// Lehmer's algorithm (Knuth 4.5.2 L): Euclid is run on the leading 62 bits in
+// machine words and the collected cofactors are applied to the full numbers
+// once per ~62 bits of progress. The last single-limb stretch is binary GCD.
+
+static limb_t gcdWord(limb_t a, limb_t b) {
+	if (a == 0 || b == 0)
+		return a | b;
+	int shift = __builtin_ctzll(a | b);
+	a >>= __builtin_ctzll(a);
+	while (b != 0) {
+		b >>= __builtin_ctzll(b);
+		if (a > b)
+			swap(a, b);
+		b -= a;
+	}
+	return a << shift;
+}
+
+// 64 bits of a starting at bit h
+static limb_t bitsFrom(const LimbVector& a, int h) {
+	int i = h / 64, s = h % 64;
+	limb_t lo = i < (int)a.size() ? a[i] >> s : 0;
+	limb_t hi = s && i + 1 < (int)a.size() ? a[i + 1] << (64 - s) : 0;
+	return lo | hi;
+}
+
+// cofactors of as many Euclid steps as the leading bits of a >= b determine;
+// false if not even one quotient could be trusted
+static bool lehmerCofactors(const BigInt& a, const BigInt& b, long long& A, long long& B, long long& C, long long& D) {
+	int h = max(0, a.bitLength() - 62);
+	long long x = (long long)bitsFrom(a.getDigits(), h), y = (long long)bitsFrom(b.getDigits(), h);
+	A = 1, B = 0, C = 0, D = 1;
+	while (y + C > 0 && y + D > 0) {
+		long long q = (x + A) / (y + C);
+		if (q != (x + B) / (y + D))
+			break;
+		long long t = A - q * C;
+		A = C, C = t;
+		t = B - q * D;
+		B = D, D = t;
+		t = x - q * y;
+		x = y, y = t;
+	}
+	return B != 0;
+}
 
+static BigInt linearCombination(const BigInt& a, long long A, const BigInt& b, long long B) {
+	BigInt res = a * A;
+	res += b * B;
+	return res;
 }
 
-BigInt jacobi(BigInt n, BigInt m) {
-	n = n % m;
-	if (n == 0 && m == 1) {
-		return 1;
-	}
-	if (n == 0 && m > 1) {
-		return 0;
+BigInt gcd(const BigInt& a, const BigInt& b) {
+	BigInt x = a.abs(), y = b.abs();
+	if (x < y)
+		swap(x, y);
+	while (y.getLength() > 1) {
+		long long A, B, C, D;
+		if (lehmerCofactors(x, y, A, B, C, D)) {
+			BigInt nx = linearCombination(x, A, y, B);
+			y = linearCombination(x, C, y, D);
+			x = move(nx);
+		}
+		else {
+			x %= y;
+			swap(x, y);
+		}
 	}
-
-	BigInt ans = 1;
-	while (n % 2 == 0) {
-		n = n / 2;
-		BigInt r = m % 8;
-		if (r == 3 || r == 5) {
-			ans = -ans;
+	if (y == 0)
+		return x;
+	limb_t w = y.getDigits()[0];
+	return gcdWord(w, x.getLength() > 1 ? (x % w).getDigits()[0] : x.getDigits()[0]);
+}
+
+// g = gcd(a, b) >= 0 with a * s + b * t = g, tracking only s through the loop
+BigInt extendedGcd(const BigInt& a, const BigInt& b, BigInt& s, BigInt& t) {
+	bool swapped = a.abs() < b.abs();
+	const BigInt& a0 = swapped ? b : a;
+	const BigInt& b0 = swapped ? a : b;
+	BigInt x = a0.abs(), y = b0.abs();
+	BigInt sx = 1, sy = 0;
+	while (y != 0) {
+		long long A, B, C, D;
+		if (y.getLength() > 1 && lehmerCofactors(x, y, A, B, C, D)) {
+			BigInt nx = linearCombination(x, A, y, B);
+			y = linearCombination(x, C, y, D);
+			x = move(nx);
+			BigInt nsx = linearCombination(sx, A, sy, B);
+			sy = linearCombination(sx, C, sy, D);
+			sx = move(nsx);
+		}
+		else {
+			BigInt q, r;
+			divmod(x, y, q, r);
+			x = move(y);
+			y = move(r);
+			BigInt nsy = sx - q * sy;
+			sx = move(sy);
+			sy = move(nsy);
 		}
 	}
-	if (n % 4 == 3 && m % 4 == 3) {
-		ans = -ans;
+	// x = |a0| sx + |b0| ty; recover ty exactly, then put the signs back
+	BigInt ty = b0.isZero() ? BigInt(0) : (x - a0.abs() * sx) / b0.abs();
+	if (a0 < 0)
+		sx = -sx;
+	if (b0 < 0)
+		ty = -ty;
+	s = swapped ? ty : sx;
+	t = swapped ? sx : ty;
+	return x;
+}
+
+BigInt gcd(int a, const BigInt& b) {
+	return gcd(BigInt(a), b);
+}
+
+// Jacobi symbol (a | n) for odd n, r is the sign collected so far. Binary
+// algorithm: strip twos from a ((2 | n) = -1 for n = 3, 5 mod 8), make a >= n
+// by swapping (reciprocity flips when both are 3 mod 4), then a -= n.
+static int jacobiWord(limb_t a, limb_t n, int r) {
+	while (a != 0) {
+		int s = __builtin_ctzll(a);
+		a >>= s;
+		if ((s & 1) && ((n & 7) == 3 || (n & 7) == 5))
+			r = -r;
+		if (a < n) {
+			swap(a, n);
+			if ((a & n & 3) == 3)
+				r = -r;
+		}
+		a -= n;
 	}
-	return ans * jacobi(m, n);
+	return n == 1 ? r : 0;
 }
 
-int jacobi_(BigInt a, BigInt b) {
-	if (gcd(a, b) != 1)
-		return 0;
+// Kronecker symbol (a | n), the Jacobi symbol for odd n > 0
+int jacobi(const BigInt& a0, const BigInt& n0) {
+	if (n0.isZero())
+		return a0 == 1 || a0 == -1 ? 1 : 0;
 	int r = 1;
-	if (a.isNegativeOne()){
-		a.abs();
-		if (b % 4 == 3)
+	BigInt n = n0.abs();
+	int v = n.lowestSetBit();
+	if (v > 0) {
+		if (!a0.testBit(0))
+			return 0;
+		n >>= v;
+		limb_t a8 = a0.getDigits()[0] & 7;
+		if (a0 < 0)
+			a8 = (8 - a8) & 7;
+		if ((v & 1) && (a8 == 3 || a8 == 5))
 			r = -r;
 	}
-	while (true) {
-		int t = 0;
-		while (a % 2 == 0) {
-			t++;
-			a = a / 2;
+	if (n0 < 0 && a0 < 0)
+		r = -r;
+
+	// (a | n) = (-1 | n) (|a| | n), (-1 | n) = -1 for n = 3 mod 4
+	if (a0 < 0 && (n.getDigits()[0] & 3) == 3)
+		r = -r;
+	BigInt a = a0.abs();
+	if (a.getDigits().size() > n.getDigits().size())
+		a %= n;
+	while (!a.isZero()) {
+		int s = a.lowestSetBit();
+		a >>= s;
+		limb_t n8 = n.getDigits()[0] & 7;
+		if ((s & 1) && (n8 == 3 || n8 == 5))
+			r = -r;
+		if (a.getDigits().size() == 1) {
+			// one reciprocity step and a word remainder leave only words
+			limb_t w = a.getDigits()[0];
+			if (n.getDigits().size() == 1)
+				return jacobiWord(w, n.getDigits()[0], r);
+			if ((w & n8 & 3) == 3)
+				r = -r;
+			return jacobiWord((n % w).getDigits()[0], w, r);
 		}
-		if (t % 2 == 1) {
-			if (b % 8 == 3 || b % 8 == 5)
+		if (a < n) {
+			swap(a, n);
+			if ((a.getDigits()[0] & n.getDigits()[0] & 3) == 3)
 				r = -r;
 		}
+		// a far above n is cut down by one division, close values by subtraction
+		if (a.getDigits().size() > n.getDigits().size())
+			a %= n;
+		else
+			a -= n;
+	}
+	return n == 1 ? r : 0;
+}
 
-		if (a % 4 == b % 4 == 3)
-			r = -r;
-		BigInt c = a;
-		a = b % c;
-		b = c;
+// first D of 5, -7, 9, -11, ... with (D | n) = -1 (Selfridge's method A);
+// 0 when an earlier D shares a factor with n != |D|, so n is composite
+static int selfridgeD(const BigInt& n) {
+	for (int d = 5; ; d = d > 0 ? -(d + 2) : -d + 2) {
+		int j = jacobi(d, n);
+		if (j == -1)
+			return d;
+		if (j == 0 && n != abs(d))
+			return 0;
+	}
+}
 
-		if (a != 0)
-			continue;
-		else
-			return r;
+// strong Lucas probable prime test with P = 1, Q = (1 - D) / 4 for Selfridge's
+// D: with n + 1 = k * 2^s, k odd, a prime n has U_k = 0 or V_(k 2^r) = 0 for
+// some r < s. U, V and Q^k are doubled over the bits of k in the Montgomery
+// domain of n (the recurrences are linear, so halving and D * x carry over).
+bool LucasSelfridgeTest(const BigInt& n) {
+	if (n == 2)
+		return true;
+	if (n < 2 || n % 2 == 0)
+		return false;
+	// squares have no D with (D | n) = -1
+	if (n.isPerfectSquare())
+		return false;
+	int d = selfridgeD(n);
+	if (d == 0)
+		return false;
+
+	MontgomeryContext ctx(n);
+	auto add = [&n](BigInt x, const BigInt& y) {
+		x += y;
+		if (x >= n)
+			x -= n;
+		return x;
+	};
+	auto sub = [&n](BigInt x, const BigInt& y) {
+		x -= y;
+		if (x < 0)
+			x += n;
+		return x;
+	};
+	auto half = [&n](BigInt x) {
+		if (x.testBit(0))
+			x += n;
+		x >>= 1;
+		return x;
+	};
+
+	BigInt k = n + 1;
+	int s = k.lowestSetBit();
+	k >>= s;
+	BigInt u = ctx.one();
+	BigInt v = u;
+	BigInt q = ctx.toMontgomery((1 - d) / 4);
+	BigInt qk = q;
+	for (int i = k.bitLength() - 2; i >= 0; i--) {
+		// U_2j = U_j V_j, V_2j = V_j^2 - 2 Q^j
+		ctx.mulInPlace(u, v);
+		ctx.squareInPlace(v);
+		v = sub(sub(move(v), qk), qk);
+		ctx.squareInPlace(qk);
+		if (k.testBit(i)) {
+			// U_(j+1) = (U_j + V_j) / 2, V_(j+1) = (D U_j + V_j) / 2
+			BigInt du = (u * abs(d)) % n;
+			if (d < 0 && !du.isZero())
+				du = n - du;
+			BigInt next = half(add(u, v));
+			v = half(add(du, v));
+			u = move(next);
+			ctx.mulInPlace(qk, q);
+		}
+	}
+	if (u.isZero() || v.isZero())
+		return true;
+	for (int r = 1; r < s; r++) {
+		ctx.squareInPlace(v);
+		v = sub(sub(move(v), qk), qk);
+		if (v.isZero())
+			return true;
+		ctx.squareInPlace(qk);
 	}
+	return false;
 }
 
-int jacobi_(int a_int, BigInt b) {
-	
-	BigInt a = BigInt(a_int);
+// Baillie-PSW: a base 2 strong probable prime that is also a strong Lucas
+// probable prime; no composite passing both is known
+bool BailliePSWTest(const BigInt& n) {
+	if (hasSmallFactor(n, PRIME_TEST_TRIAL_BOUND))
+		return false;
+	return MillerRabinTest_Base(n, 2) && LucasSelfridgeTest(n);
+}
 
-	if (gcd(a, b) != 1)
-		return 0;
-	int r = 1;
-	if (a.isNegativeOne()) {
-		a.abs();
-		if (b % 4 == 3)
-			r = -r;
+// random primes
+//
+// A random odd start x is reduced once modulo every prime below 2^16; after that
+// x + 2j is sieved over a window of PRIME_SIEVE_WINDOW offsets with the residues
+// alone, and moving the window on only adds 2 * PRIME_SIEVE_WINDOW to each
+// residue. About one candidate in ten survives the sieve and gets BailliePSWTest.
+
+static const int PRIME_SIEVE_WINDOW = 4096;
+
+BigInt generatePrime(int bits) {
+	if (bits < 2) {
+		throw "ValueError";
 	}
+	if (bits == 2)
+		return BigInt((int)(2 + (ChaChaRandom::local().next() & 1)));
+
+	// a prime candidate must not be struck out by itself
+	const uint32_t* all = SMALL_PRIMES.primes;
+	size_t count = SMALL_PRIMES.count;
+	if (bits <= 17)
+		count = lower_bound(all, all + count, 1u << (bits - 1)) - all;
+	vector<uint32_t> residues(count);
+	vector<uint64_t> sieve(PRIME_SIEVE_WINDOW / 64);
+
 	while (true) {
-		int t = 0;
-		while (a % 2 == 0) {
-			t++;
-			a = a / 2;
+		int len = (bits + 63) / 64;
+		LimbVector digits(len);
+		ChaChaRandom::local().fill(digits.data(), len);
+		BigInt x(move(digits), false);
+		x >>= len * 64 - bits;
+		x.setBit(bits - 1);
+		x.setBit(0);
+		// one BigInt remainder per word product, the primes in it take the rest
+		for (int g = 0; g < SMALL_PRIMES.groups && (size_t)SMALL_PRIMES.first[g] < count; g++) {
+			limb_t r = (x % SMALL_PRIMES.products[g]).getDigits()[0];
+			for (int i = SMALL_PRIMES.first[g]; i < SMALL_PRIMES.first[g + 1] && (size_t)i < count; i++)
+				residues[i] = (uint32_t)(r % all[i]);
 		}
-		if (t % 2 == 1) {
-			if (b % 8 == 3 || b % 8 == 5)
-				r = -r;
+
+		while (true) {
+			// bit j set: x + 2j has a factor below 2^16
+			fill(sieve.begin(), sieve.end(), 0);
+			for (size_t i = 0; i < count; i++) {
+				uint32_t p = all[i];
+				uint32_t need = residues[i] == 0 ? 0 : p - residues[i];
+				for (uint32_t j = (need & 1) ? (need + p) / 2 : need / 2; j < (uint32_t)PRIME_SIEVE_WINDOW; j += p)
+					sieve[j / 64] |= (uint64_t)1 << (j % 64);
+			}
+			for (int j = 0; j < PRIME_SIEVE_WINDOW; j++) {
+				if (sieve[j / 64] >> (j % 64) & 1)
+					continue;
+				BigInt candidate = x + 2 * j;
+				if (candidate.bitLength() > bits)
+					break;
+				if (BailliePSWTest(candidate))
+					return candidate;
+			}
+			x += 2 * PRIME_SIEVE_WINDOW;
+			if (x.bitLength() > bits)
+				break;
+			for (size_t i = 0; i < count; i++)
+				residues[i] = (uint32_t)((residues[i] + 2 * PRIME_SIEVE_WINDOW) % all[i]);
 		}
+	}
+}
 
-		if (a % 4 == b % 4 == 3)
-			r = -r;
-		BigInt c = a;
-		a = b % c;
-		b = c;
+// factorization
+//
+// factorize strips the primes below 2^16 by trial division and splits what is
+// left recursively: perfect powers by iroot, then Pollard-Brent rho with a small
+// step budget, then ECM stage 1 with growing B1 until a factor turns up. Rho
+// and ECM work in the Montgomery domain of n, which gcd(., n) doesn't notice.
+
+static const int RHO_BATCH = 128;          // rho steps per gcd
+static const long RHO_STEP_BUDGET = 1 << 16;
+static const int FACTOR_PRIME_ROUNDS = 25; // MillerRabinTest rounds for the parts
+
+struct EcmTier {
+	limb_t b1;
+	int curves;
+};
+
+// GMP-ECM style B1 levels, roughly optimal for factors of 20, 25, ..., 45 digits
+static const EcmTier ECM_TIERS[] = {
+	{ 2000, 25 }, { 11000, 90 }, { 50000, 300 }, { 250000, 700 }, { 1000000, 1800 }
+};
+
+// x = x + y and x = x - y for residues below m, in place so the loops reuse limbs
+static void addMod(BigInt& x, const BigInt& y, const BigInt& m) {
+	x += y;
+	if (x >= m)
+		x -= m;
+}
+
+static void subMod(BigInt& x, const BigInt& y, const BigInt& m) {
+	x -= y;
+	if (x < 0)
+		x += m;
+}
+
+// Brent's cycle search on x -> x^2 + c, the differences multiplied together and
+// one gcd taken every RHO_BATCH steps; a batch that overshoots to gcd = n is
+// replayed step by step from its saved start
+BigInt pollardBrent(const BigInt& n, const BigInt& c, long maxSteps) {
+	if (n < 3 || n % 2 == 0) {
+		throw "ValueError";
+	}
+	MontgomeryContext ctx(n);
+	BigInt cm = ctx.toMontgomery(c);
+	// x -> x^2 + c in place
+	auto f = [&](BigInt& x) {
+		ctx.squareInPlace(x);
+		addMod(x, cm, n);
+	};
+
+	BigInt y = ctx.toMontgomery(2);
+	BigInt x, ys, diff;
+	BigInt q = ctx.one();
+	BigInt g = 1;
+	long steps = 0;
+	for (long r = 1; g == 1; r *= 2) {
+		x = y;
+		for (long i = 0; i < r; i++)
+			f(y);
+		for (long k = 0; k < r && g == 1; k += RHO_BATCH) {
+			ys = y;
+			long batch = min((long)RHO_BATCH, r - k);
+			for (long i = 0; i < batch; i++) {
+				f(y);
+				diff = x;
+				subMod(diff, y, n);
+				ctx.mulInPlace(q, diff);
+			}
+			g = gcd(q, n);
+			steps += batch;
+		}
+		if (g == 1 && steps >= maxSteps)
+			return 0;
+	}
+	if (g == n) {
+		do {
+			f(ys);
+			diff = x;
+			subMod(diff, ys, n);
+			g = gcd(diff, n);
+		} while (g == 1);
+	}
+	return g == n ? BigInt(0) : g;
+}
+
+// points are (X : Z) on By^2 = x^3 + Ax^2 + x, a24 = (A + 2) / 4, all values in
+// the Montgomery domain of n
+struct EcmCurve {
+	MontgomeryContext& ctx;
+	const BigInt& n;
+	BigInt a24;
+	// temporaries kept across steps; results are swapped out of them at the end,
+	// so outputs may alias inputs
+	BigInt s, d, t, w;
+
+	EcmCurve(MontgomeryContext& ctx_, const BigInt& n_, const BigInt& a24_) : ctx(ctx_), n(n_), a24(a24_) {}
+
+	void dbl(const BigInt& x, const BigInt& z, BigInt& rx, BigInt& rz) {
+		// s = (x + z)^2, d = (x - z)^2, t = s - d = 4xz
+		s = x;
+		addMod(s, z, n);
+		ctx.squareInPlace(s);
+		d = x;
+		subMod(d, z, n);
+		ctx.squareInPlace(d);
+		t = s;
+		subMod(t, d, n);
+		// X = s d, Z = t (d + a24 t)
+		ctx.mulInPlace(s, d);
+		w = a24;
+		ctx.mulInPlace(w, t);
+		addMod(w, d, n);
+		ctx.mulInPlace(w, t);
+		swap(rx, s);
+		swap(rz, w);
+	}
+
+	// P + Q from P, Q and P - Q
+	void add(const BigInt& xp, const BigInt& zp, const BigInt& xq, const BigInt& zq,
+		const BigInt& xd, const BigInt& zd, BigInt& rx, BigInt& rz) {
+		// s = (xp - zp)(xq + zq), d = (xp + zp)(xq - zq)
+		s = xp;
+		subMod(s, zp, n);
+		t = xq;
+		addMod(t, zq, n);
+		ctx.mulInPlace(s, t);
+		d = xp;
+		addMod(d, zp, n);
+		t = xq;
+		subMod(t, zq, n);
+		ctx.mulInPlace(d, t);
+		// X = zd (s + d)^2, Z = xd (s - d)^2
+		w = s;
+		addMod(w, d, n);
+		ctx.squareInPlace(w);
+		ctx.mulInPlace(w, zd);
+		subMod(s, d, n);
+		ctx.squareInPlace(s);
+		ctx.mulInPlace(s, xd);
+		swap(rx, w);
+		swap(rz, s);
+	}
+
+	// (x : z) = k (x : z) by the Montgomery ladder, k >= 1
+	void multiply(BigInt& x, BigInt& z, limb_t k) {
+		BigInt x0 = x, z0 = z, x1, z1;
+		dbl(x, z, x1, z1);
+		for (int i = 62 - __builtin_clzll(k); i >= 0; i--) {
+			if ((k >> i) & 1) {
+				add(x1, z1, x0, z0, x, z, x0, z0);
+				dbl(x1, z1, x1, z1);
+			}
+			else {
+				add(x0, z0, x1, z1, x, z, x1, z1);
+				dbl(x0, z0, x0, z0);
+			}
+		}
+		x = move(x0);
+		z = move(z0);
+	}
+};
 
-		if (a != 0)
+static vector<uint32_t> primesUpTo(limb_t limit) {
+	vector<bool> composite(limit + 1);
+	vector<uint32_t> res;
+	for (limb_t p = 2; p <= limit; p++) {
+		if (composite[p])
 			continue;
-		else
-			return r;
+		res.push_back((uint32_t)p);
+		for (limb_t q = p * p; q <= limit; q += p)
+			composite[q] = true;
 	}
+	return res;
 }
 
-int LucasSelfridgeTest(BigInt n) {
-	int d = 5;
-	int i = 2;
-	while (true) {
-		if (jacobi_(d, n) == -1)
-			return d;
-		i++;
-		d = (abs(d) + 2) * pow(-1, i);
+// stage 1 on one random curve (Suyama's parametrization): the point is
+// multiplied by every prime power up to b1, and a factor shows up as
+// gcd(Z, n) when the group order modulo it is b1-smooth
+static BigInt ecmCurve(MontgomeryContext& ctx, const BigInt& n, limb_t b1,
+	const vector<uint32_t>& primes, const atomic<bool>& stop) {
+	BigInt sigma = randBigInt(n - 6) + 6;
+	BigInt u = sigma.square(n);
+	subMod(u, 5, n);
+	BigInt v = (sigma * 4) % n;
+	BigInt u3 = (u.square() * u) % n;
+	BigInt vu = v;
+	subMod(vu, u, n);
+	BigInt num = ((vu.square() * vu) % n * ((u * 3 + v) % n)) % n;
+	BigInt den = (u3 * v * 16) % n;
+	BigInt inv, t;
+	BigInt g = extendedGcd(den, n, inv, t);
+	if (g != 1)
+		return g == n ? BigInt(0) : g;
+
+	EcmCurve curve(ctx, n, ctx.toMontgomery((num * inv).mathMod(n)));
+	BigInt x = ctx.toMontgomery(u3);
+	BigInt z = ctx.toMontgomery((v.square() * v) % n);
+	// prime powers are packed into word multipliers
+	limb_t k = 1;
+	for (uint32_t p : primes) {
+		if (p > b1)
+			break;
+		limb_t q = p;
+		while (q <= b1 / p)
+			q *= p;
+		if (k > ~(limb_t)0 / q) {
+			if (stop.load(memory_order_relaxed))
+				return 0;
+			curve.multiply(x, z, k);
+			k = 1;
+		}
+		k *= q;
 	}
+	curve.multiply(x, z, k);
+	g = gcd(z, n);
+	return g == n ? BigInt(0) : g;
 }
 
-bool BailliePSWTest(BigInt n) {
-	bool res_1 = MillerRabinTest_Base(n, 2);
-
-	int d = LucasSelfridgeTest(n);
-	int p = 1;
-	int q = (1 - d) / 4;
-	BigInt a = BigInt((p + sqrt(d)) / 2);
-	BigInt b = BigInt((p - sqrt(d)) / 2);
-	BigInt v = a.pow(n) + b.pow(b);
-	
-	int res_2;
+BigInt ecmStage1(const BigInt& n, limb_t b1, int curves) {
+	if (n < 7 || n % 2 == 0 || curves <= 0) {
+		throw "ValueError";
+	}
+	vector<uint32_t> primes = primesUpTo(b1);
+	WorkStealingPool& pool = WorkStealingPool::shared();
+	vector<unique_ptr<MontgomeryContext>> contexts(pool.size());
+	atomic<bool> found(false);
+	mutex resultLock;
+	BigInt result = 0;
+	pool.parallelFor(curves, [&](size_t, int worker) {
+		if (found.load(memory_order_relaxed))
+			return;
+		if (!contexts[worker])
+			contexts[worker].reset(new MontgomeryContext(n));
+		BigInt g = ecmCurve(*contexts[worker], n, b1, primes, found);
+		if (g > 1) {
+			lock_guard<mutex> guard(resultLock);
+			if (!found) {
+				result = g;
+				found = true;
+			}
+		}
+	});
+	return result;
+}
 
-	if (v % n == n)
-		res_2 = 1;
-	else
-		res_2 = 0;
-	if (res_1 == res_2 == 1)
-		return true;
-	else 
-		return false;
+// a nontrivial factor of n, which is odd, composite and free of factors below 2^16
+static BigInt findFactor(const BigInt& n) {
+	// n = r^k; k can't exceed bitLength / 16
+	for (int k = 2; k <= n.bitLength() / 16; k++) {
+		BigInt r = n.iroot(k);
+		if (r.pow(k) == n)
+			return r;
+	}
+	BigInt f = pollardBrent(n, 1, RHO_STEP_BUDGET);
+	if (f != 0)
+		return f;
+	const size_t tiers = sizeof(ECM_TIERS) / sizeof(ECM_TIERS[0]);
+	for (size_t tier = 0; ; tier = min(tier + 1, tiers - 1)) {
+		f = ecmStage1(n, ECM_TIERS[tier].b1, ECM_TIERS[tier].curves);
+		if (f != 0)
+			return f;
+	}
 }
 
-void print_base_2(BigInt n) {
-	int s = 0;
-	BigInt t = n;
-	vector<int> res;
-	res.push_back(0);
-	while (t / 2 != 0) {
-		t = t / 2;
-		s++;
-		res.push_back(0);
+vector<BigInt> factorize(const BigInt& n) {
+	if (n.isZero()) {
+		throw "ValueError";
 	}
-	res[s] = 1;
-	while (true)
-	{
-		n = n - pow(2, s);
-		if (n == 0)
-			break;
-		t = n;
-		s = 0;
-		while (t / 2 != 0) {
-			t = t / 2;
-			s++;
+	vector<BigInt> factors;
+	BigInt m = n.abs();
+	int twos = m.lowestSetBit();
+	for (int i = 0; i < twos; i++)
+		factors.push_back(2);
+	m >>= twos;
+
+	// trial division, one word remainder per product of small primes
+	for (int g = 0; g < SMALL_PRIMES.groups && m > 1; g++) {
+		limb_t product = SMALL_PRIMES.products[g];
+		if (gcdWord((m % product).getDigits()[0], product) == 1)
+			continue;
+		for (int i = SMALL_PRIMES.first[g]; i < SMALL_PRIMES.first[g + 1]; i++) {
+			limb_t p = SMALL_PRIMES.primes[i];
+			while ((m % p).isZero()) {
+				m /= p;
+				factors.push_back(BigInt(p));
+			}
 		}
-		res[s] = 1;
 	}
 
-	for (int i = res.size() - 1; i >= 0; i--) {
-		cout << res[i];
+	// no factor below 2^16 is left, so anything below 2^32 is prime
+	vector<BigInt> pending;
+	if (m > 1)
+		pending.push_back(m);
+	while (!pending.empty()) {
+		BigInt c = move(pending.back());
+		pending.pop_back();
+		if (c.bitLength() <= 32 || MillerRabinTest(c, FACTOR_PRIME_ROUNDS)) {
+			factors.push_back(c);
+			continue;
+		}
+		BigInt f = findFactor(c);
+		pending.push_back(c / f);
+		pending.push_back(move(f));
 	}
+	sort(factors.begin(), factors.end());
+	return factors;
 }
 
-int* char_base2(char a) {
-	int int_a = int(a);
-	int t = int_a;
-	int* byte_a = new int[8]{ 0, 0, 0, 0, 0, 0, 0, 0 };
-	int s = 0;
-	
-	while (true)
-	{
-		if (int_a % 2 == 1) {
-			byte_a[7] = 1;
-			int_a--;
-		}
+void print_base_2(const BigInt& n) {
+	cout << n.toBinaryString();
+}
 
-		if (int_a == 0)
-			break;
-		while (t / 2 != 0) {
-			t = t / 2;
-			s++;
+// base64
+//
+// Bulk kernels handle whole 12/24 byte (16/32 char) blocks and return how much
+// they consumed; the scalar code finishes the tail, padding and errors. The
+// kernels are picked once from what the CPU supports.
+
+static const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+typedef size_t (*Base64EncodeKernel)(const uint8_t* in, size_t len, char* out);
+typedef size_t (*Base64DecodeKernel)(const char* in, size_t len, uint8_t* out);
+
+struct Base64Kernels {
+	Base64EncodeKernel encode;
+	Base64DecodeKernel decode;
+};
+
+// 6-bit value of each character, 0xff for characters outside the alphabet
+static const uint8_t* base64DecodeTable() {
+	static const struct Table {
+		uint8_t v[256];
+		Table() {
+			memset(v, 0xff, sizeof(v));
+			for (int i = 0; i < 64; i++)
+				v[(uint8_t)BASE64_ALPHABET[i]] = (uint8_t)i;
 		}
-		t = int_a - pow(2, s);
-		int_a = t;
-		byte_a[7 - s] = 1;
-		s = 0;
-		
+	} table;
+	return table.v;
+}
+
+static size_t encodeScalar(const uint8_t* in, size_t len, char* out) {
+	size_t i = 0;
+	for (; i + 3 <= len; i += 3) {
+		uint32_t w = (uint32_t)in[i] << 16 | (uint32_t)in[i + 1] << 8 | in[i + 2];
+		*out++ = BASE64_ALPHABET[w >> 18];
+		*out++ = BASE64_ALPHABET[(w >> 12) & 63];
+		*out++ = BASE64_ALPHABET[(w >> 6) & 63];
+		*out++ = BASE64_ALPHABET[w & 63];
+	}
+	return i;
+}
+
+// whole unpadded quanta only; stops before the first one with '=' or a bad character
+static size_t decodeScalar(const char* in, size_t len, uint8_t* out) {
+	const uint8_t* table = base64DecodeTable();
+	size_t i = 0;
+	for (; i + 4 <= len; i += 4) {
+		uint32_t a = table[(uint8_t)in[i]], b = table[(uint8_t)in[i + 1]];
+		uint32_t c = table[(uint8_t)in[i + 2]], d = table[(uint8_t)in[i + 3]];
+		if ((a | b | c | d) > 63)
+			break;
+		uint32_t w = a << 18 | b << 12 | c << 6 | d;
+		*out++ = (uint8_t)(w >> 16);
+		*out++ = (uint8_t)(w >> 8);
+		*out++ = (uint8_t)w;
+	}
+	return i;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// 12 input bytes at the bottom of a lane -> 16 six-bit values, one per byte (Mula)
+#define BASE64_ENC_SHUFFLE 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1
+// offsets that take six-bit values to ASCII, indexed by a small class number
+#define BASE64_ENC_OFFSETS 65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0
+// decode validation and offsets by nibble (aklomp/base64)
+#define BASE64_DEC_LUT_LO 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+#define BASE64_DEC_LUT_HI 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+#define BASE64_DEC_ROLL 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+#define BASE64_DEC_PACK 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+
+__attribute__((target("ssse3")))
+static size_t encodeSsse3(const uint8_t* in, size_t len, char* out) {
+	const __m128i shuffle = _mm_set_epi8(BASE64_ENC_SHUFFLE);
+	const __m128i offsets = _mm_setr_epi8(BASE64_ENC_OFFSETS);
+	size_t i = 0;
+	// 16-byte loads, 12 bytes used per step
+	for (; i + 16 <= len; i += 12) {
+		__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + i)), shuffle);
+		__m128i hi = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+		__m128i lo = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+		v = _mm_or_si128(hi, lo);
+		__m128i idx = _mm_subs_epu8(v, _mm_set1_epi8(51));
+		idx = _mm_sub_epi8(idx, _mm_cmpgt_epi8(v, _mm_set1_epi8(25)));
+		v = _mm_add_epi8(v, _mm_shuffle_epi8(offsets, idx));
+		_mm_storeu_si128((__m128i*)out, v);
+		out += 16;
+	}
+	return i;
+}
+
+__attribute__((target("ssse3")))
+static size_t decodeSsse3(const char* in, size_t len, uint8_t* out) {
+	const __m128i lutLo = _mm_setr_epi8(BASE64_DEC_LUT_LO);
+	const __m128i lutHi = _mm_setr_epi8(BASE64_DEC_LUT_HI);
+	const __m128i lutRoll = _mm_setr_epi8(BASE64_DEC_ROLL);
+	const __m128i mask2F = _mm_set1_epi8(0x2f);
+	const __m128i pack = _mm_setr_epi8(BASE64_DEC_PACK);
+	size_t i = 0;
+	for (; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+		__m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(v, 4), mask2F);
+		__m128i loNibbles = _mm_and_si128(v, mask2F);
+		__m128i bad = _mm_and_si128(_mm_shuffle_epi8(lutLo, loNibbles), _mm_shuffle_epi8(lutHi, hiNibbles));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) != 0xffff)
+			break;
+		__m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(_mm_cmpeq_epi8(v, mask2F), hiNibbles));
+		v = _mm_add_epi8(v, roll);
+		v = _mm_madd_epi16(_mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+		v = _mm_shuffle_epi8(v, pack);
+		_mm_storel_epi64((__m128i*)out, v);
+		uint32_t tail = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+		memcpy(out + 8, &tail, 4);
+		out += 12;
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static size_t encodeAvx2(const uint8_t* in, size_t len, char* out) {
+	const __m256i shuffle = _mm256_setr_m128i(_mm_set_epi8(BASE64_ENC_SHUFFLE), _mm_set_epi8(BASE64_ENC_SHUFFLE));
+	const __m256i offsets = _mm256_setr_epi8(BASE64_ENC_OFFSETS, BASE64_ENC_OFFSETS);
+	size_t i = 0;
+	// each lane takes 12 bytes; the upper load reads 4 bytes past them
+	for (; i + 28 <= len; i += 24) {
+		__m256i v = _mm256_setr_m128i(_mm_loadu_si128((const __m128i*)(in + i)), _mm_loadu_si128((const __m128i*)(in + i + 12)));
+		v = _mm256_shuffle_epi8(v, shuffle);
+		__m256i hi = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+		__m256i lo = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+		v = _mm256_or_si256(hi, lo);
+		__m256i idx = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+		idx = _mm256_sub_epi8(idx, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(25)));
+		v = _mm256_add_epi8(v, _mm256_shuffle_epi8(offsets, idx));
+		_mm256_storeu_si256((__m256i*)out, v);
+		out += 32;
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static size_t decodeAvx2(const char* in, size_t len, uint8_t* out) {
+	const __m256i lutLo = _mm256_setr_epi8(BASE64_DEC_LUT_LO, BASE64_DEC_LUT_LO);
+	const __m256i lutHi = _mm256_setr_epi8(BASE64_DEC_LUT_HI, BASE64_DEC_LUT_HI);
+	const __m256i lutRoll = _mm256_setr_epi8(BASE64_DEC_ROLL, BASE64_DEC_ROLL);
+	const __m256i mask2F = _mm256_set1_epi8(0x2f);
+	const __m256i pack = _mm256_setr_epi8(BASE64_DEC_PACK, BASE64_DEC_PACK);
+	size_t i = 0;
+	for (; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(in + i));
+		__m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(v, 4), mask2F);
+		__m256i loNibbles = _mm256_and_si256(v, mask2F);
+		if (!_mm256_testz_si256(_mm256_shuffle_epi8(lutLo, loNibbles), _mm256_shuffle_epi8(lutHi, hiNibbles)))
+			break;
+		__m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(_mm256_cmpeq_epi8(v, mask2F), hiNibbles));
+		v = _mm256_add_epi8(v, roll);
+		v = _mm256_madd_epi16(_mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140)), _mm256_set1_epi32(0x00011000));
+		v = _mm256_shuffle_epi8(v, pack);
+		v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+		_mm_storeu_si128((__m128i*)out, _mm256_castsi256_si128(v));
+		_mm_storel_epi64((__m128i*)(out + 16), _mm256_extracti128_si256(v, 1));
+		out += 24;
 	}
-	return byte_a;
+	return i;
 }
 
-int calc_int_from_base2(vector<int> arr) {
-	int s = 5;
-	int res = 0;
-	for (int i = 0; i < arr.size(); i++) {
-		if (arr[i] == 1) {
-			res += pow(2, s);
-		}
-		s--;
+static Base64Kernels selectBase64Kernels() {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return { encodeAvx2, decodeAvx2 };
+	if (__builtin_cpu_supports("ssse3"))
+		return { encodeSsse3, decodeSsse3 };
+	return { encodeScalar, decodeScalar };
+}
+
+#else
+
+static Base64Kernels selectBase64Kernels() {
+	return { encodeScalar, decodeScalar };
+}
+
+#endif
+
+static const Base64Kernels& base64Kernels() {
+	static const Base64Kernels kernels = selectBase64Kernels();
+	return kernels;
+}
+
+size_t base64EncodedLength(size_t len) {
+	return (len + 2) / 3 * 4;
+}
+
+size_t base64Encode(const uint8_t* data, size_t len, char* out) {
+	size_t done = base64Kernels().encode(data, len, out);
+	done += encodeScalar(data + done, len - done, out + done / 3 * 4);
+	char* p = out + done / 3 * 4;
+	size_t rest = len - done;
+	if (rest) {
+		uint32_t w = (uint32_t)data[done] << 16 | (rest == 2 ? (uint32_t)data[done + 1] << 8 : 0);
+		*p++ = BASE64_ALPHABET[w >> 18];
+		*p++ = BASE64_ALPHABET[(w >> 12) & 63];
+		*p++ = rest == 2 ? BASE64_ALPHABET[(w >> 6) & 63] : '=';
+		*p++ = '=';
 	}
+	return p - out;
+}
+
+string base64Encode(const uint8_t* data, size_t len) {
+	string res(base64EncodedLength(len), '\0');
+	base64Encode(data, len, &res[0]);
 	return res;
 }
 
-int* get_indexes(char* arr, int status_) {
-	vector<int> bits;
-	int* indexes = new int[4];
-	//initialize bits
-	for (int i = 0; i < 3; i++) {
-		int* bits_8 = char_base2(arr[i]);
-		for (int j = 0; j < 8; j++) {
-			bits.push_back(bits_8[j]);
+size_t base64DecodedMaxLength(size_t len) {
+	return len / 4 * 3;
+}
+
+// padded input only, len a multiple of 4
+size_t base64Decode(const char* text, size_t len, uint8_t* out) {
+	if (len % 4 != 0) {
+		throw "ValueError";
+	}
+	size_t done = base64Kernels().decode(text, len, out);
+	done += decodeScalar(text + done, len - done, out + done / 4 * 3);
+	uint8_t* p = out + done / 4 * 3;
+	if (done == len)
+		return p - out;
+	// only the last quantum may be left, with one or two '='
+	const uint8_t* table = base64DecodeTable();
+	const char* q = text + done;
+	if (len - done != 4 || q[3] != '=' || table[(uint8_t)q[0]] > 63 || table[(uint8_t)q[1]] > 63) {
+		throw "ValueError";
+	}
+	uint32_t w = (uint32_t)table[(uint8_t)q[0]] << 18 | (uint32_t)table[(uint8_t)q[1]] << 12;
+	*p++ = (uint8_t)(w >> 16);
+	if (q[2] != '=') {
+		if (table[(uint8_t)q[2]] > 63) {
+			throw "ValueError";
 		}
+		w |= (uint32_t)table[(uint8_t)q[2]] << 6;
+		*p++ = (uint8_t)(w >> 8);
+	}
+	return p - out;
+}
+
+vector<uint8_t> base64Decode(const string& text) {
+	vector<uint8_t> res(base64DecodedMaxLength(text.size()));
+	res.resize(base64Decode(text.data(), text.size(), res.data()));
+	return res;
+}
+
+Base64Encoder::Base64Encoder() : pendingLen(0) {}
+
+void Base64Encoder::update(const uint8_t* data, size_t len, string& out) {
+	// complete a held back group first
+	while (pendingLen > 0 && pendingLen < 3 && len > 0) {
+		pending[pendingLen++] = *data++;
+		len--;
 	}
-	// handle situations
-	if (status_ == 1) {
-		for (int i = 16; i < bits.size(); i++)
-			bits[i] = 0;
+	if (pendingLen == 3) {
+		size_t at = out.size();
+		out.resize(at + 4);
+		base64Encode(pending, 3, &out[at]);
+		pendingLen = 0;
 	}
-	if (status_ == 2) {
-		for (int i = 8; i < bits.size(); i++)
-			bits[i] = 0;
+	size_t whole = len / 3 * 3;
+	if (whole) {
+		size_t at = out.size();
+		out.resize(at + whole / 3 * 4);
+		base64Encode(data, whole, &out[at]);
 	}
-	
-	// calculate indexes
-	vector<int> bits_6;
-	for (int i = 0; i < 4; i++) {
-		for (int j = 0; j < 6; j++) {
-			bits_6.push_back(bits[j + (i * 6)]);
-		}
-		indexes[i] = calc_int_from_base2(bits_6);
-		bits_6.clear();
+	for (size_t i = whole; i < len; i++)
+		pending[pendingLen++] = data[i];
+}
+
+void Base64Encoder::finish(string& out) {
+	if (pendingLen > 0) {
+		size_t at = out.size();
+		out.resize(at + 4);
+		base64Encode(pending, pendingLen, &out[at]);
+		pendingLen = 0;
 	}
+}
 
-	return indexes;
+Base64Decoder::Base64Decoder() : pendingLen(0), finished(false) {}
+
+void Base64Decoder::update(const char* text, size_t len, vector<uint8_t>& out) {
+	while (pendingLen > 0 && pendingLen < 4 && len > 0) {
+		pending[pendingLen++] = *text++;
+		len--;
+	}
+	if (pendingLen == 4) {
+		flush(pending, 4, out);
+		pendingLen = 0;
+	}
+	size_t whole = len / 4 * 4;
+	if (whole)
+		flush(text, whole, out);
+	for (size_t i = whole; i < len; i++)
+		pending[pendingLen++] = text[i];
 }
 
-string n_to_str(BigInt n) {
-	string res = "";
-	vector<int> dig = n.getDigits();
-	for (int i = dig.size()-1; i >= 0 ; i--) {
-		res = res + to_string(dig[i]);
+void Base64Decoder::flush(const char* text, size_t len, vector<uint8_t>& out) {
+	// nothing may follow a padded quantum
+	if (finished) {
+		throw "ValueError";
 	}
-	dig.clear();
-	/*string reverse_res = "";
-	for (int i = res.size() - 1; i >= 0; i--) {
-		reverse_res += res[i];
+	size_t at = out.size();
+	out.resize(at + base64DecodedMaxLength(len));
+	out.resize(at + base64Decode(text, len, out.data() + at));
+	finished = text[len - 1] == '=';
+}
+
+// out is there to mirror Base64Encoder::finish: update() decodes every full
+// quartet at once, so the decoder never holds bytes back and only checks here
+// that no partial quartet is left
+void Base64Decoder::finish(vector<uint8_t>&) {
+	if (pendingLen != 0) {
+		throw "ValueError";
 	}
-	return reverse_res;
-	*/
-	return res;
 }
 
-void print_base_64(BigInt n) {
-	string BASE_64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-	string res = "";
-	int status_ = 0;
-	string digits = n_to_str(n);
-	int length = digits.length();
-
-	char* chars = new char[3];
-	int* indexes = new int[3];
-	for (int i = 0; i  < length; i += 3) {
-		if (i + 1 == length - 1) {
-			chars[0] = char(digits[i]);
-			chars[1] = char(digits[i + 1]);
-			chars[2] = '0';
-			status_ = 1;
-		}
-		else if (i == length - 1) {
-			chars[0] = char(digits[i]);
-			chars[1] = '0';
-			chars[2] = '0';
-			status_ = 2;
-		}
-		else {
-			chars[0] = char(digits[i]);
-			chars[1] = char(digits[i + 1]);
-			chars[2] = char(digits[i + 2]);
-			status_ = 0;
-		}
+static const size_t BASE64_STREAM_BLOCK = 3 << 16;
 
-		indexes = get_indexes(chars, status_);
-		for (int i = 0; i < 4; i++) {
-			res = res + BASE_64[indexes[i]];
-		}
-		if (status_ != 0)
-			break;
+void base64Encode(istream& in, ostream& out) {
+	vector<uint8_t> buf(BASE64_STREAM_BLOCK);
+	Base64Encoder encoder;
+	string chunk;
+	while (in) {
+		in.read((char*)buf.data(), buf.size());
+		chunk.clear();
+		encoder.update(buf.data(), (size_t)in.gcount(), chunk);
+		out.write(chunk.data(), chunk.size());
 	}
-	if (status_ == 1) 
-		res[int(res.size()) - 1] = '=';
-	
-	if (status_ == 2) 
-		res[int(res.size()) - 1] = res[int(res.size()) - 2] = '=';
+	chunk.clear();
+	encoder.finish(chunk);
+	out.write(chunk.data(), chunk.size());
+}
+
+void base64Decode(istream& in, ostream& out) {
+	vector<char> buf(BASE64_STREAM_BLOCK);
+	Base64Decoder decoder;
+	vector<uint8_t> chunk;
+	while (in) {
+		in.read(buf.data(), buf.size());
+		chunk.clear();
+		decoder.update(buf.data(), (size_t)in.gcount(), chunk);
+		out.write((const char*)chunk.data(), chunk.size());
+	}
+	decoder.finish(chunk);
+}
+
+string BigInt::toBase64() const {
+	// zero still gets one byte so the text is never empty
+	vector<uint8_t> bytes = toBytes();
+	if (bytes.empty())
+		bytes.push_back(0);
+	string res = isNegative ? "-" : "";
+	return res + base64Encode(bytes.data(), bytes.size());
+}
+
+BigInt BigInt::fromBase64(const string& text) {
+	bool negative = !text.empty() && text[0] == '-';
+	size_t start = negative ? 1 : 0;
+	vector<uint8_t> bytes(base64DecodedMaxLength(text.size() - start));
+	bytes.resize(base64Decode(text.data() + start, text.size() - start, bytes.data()));
+	return fromBytes(bytes.data(), bytes.size(), ByteOrder::BigEndian, negative);
+}
 
-	cout << "\nEncoded \n" << n << "\nas \n" << res;
+void print_base_64(const BigInt& n) {
+	cout << "\nEncoded \n" << n << "\nas \n" << n.toBase64();
 }
 
 int main() {
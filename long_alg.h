@@ -1,97 +1,737 @@
 #include <iostream>
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
 
 using namespace std;
 
+typedef uint64_t limb_t;
+typedef unsigned __int128 dlimb_t;
+
+// Limb storage that keeps up to N limbs inside the object and only asks the
+// allocator for memory beyond that, so small values never touch the heap.
+template <size_t N, typename Alloc = allocator<limb_t>>
+class SmallLimbVector : private Alloc {
+private:
+	typedef allocator_traits<Alloc> Traits;
+
+	limb_t* ptr;
+	size_t len;
+	size_t cap;
+	limb_t local[N];
+
+	Alloc& alloc() { return *this; }
+	bool isLocal() const { return ptr == local; }
+
+	void release() {
+		if (!isLocal())
+			Traits::deallocate(alloc(), ptr, cap);
+		ptr = local;
+		cap = N;
+	}
+
+	void grow(size_t need) {
+		if (need <= cap)
+			return;
+		size_t newCap = max(need, cap * 2);
+		limb_t* p = Traits::allocate(alloc(), newCap);
+		copy(ptr, ptr + len, p);
+		release();
+		ptr = p;
+		cap = newCap;
+	}
+
+	// takes other's heap buffer if it has one, otherwise copies its inline limbs
+	void steal(SmallLimbVector& other) {
+		release();
+		if (other.isLocal()) {
+			copy(other.local, other.local + other.len, local);
+		}
+		else {
+			ptr = other.ptr;
+			cap = other.cap;
+			other.ptr = other.local;
+			other.cap = N;
+		}
+		len = other.len;
+		other.len = 0;
+	}
+public:
+	typedef limb_t value_type;
+	typedef limb_t* iterator;
+	typedef const limb_t* const_iterator;
+	typedef Alloc allocator_type;
+
+	SmallLimbVector(const Alloc& a = Alloc()) : Alloc(a), ptr(local), len(0), cap(N) {}
+
+	explicit SmallLimbVector(size_t n, limb_t value = 0, const Alloc& a = Alloc()) : SmallLimbVector(a) {
+		assign(n, value);
+	}
+
+	SmallLimbVector(const limb_t* first, const limb_t* last, const Alloc& a = Alloc()) : SmallLimbVector(a) {
+		assign(first, last);
+	}
+
+	SmallLimbVector(const SmallLimbVector& other)
+		: Alloc(Traits::select_on_container_copy_construction(other)), ptr(local), len(0), cap(N) {
+		assign(other.begin(), other.end());
+	}
+
+	SmallLimbVector(SmallLimbVector&& other) noexcept : Alloc(std::move(other.alloc())), ptr(local), len(0), cap(N) {
+		steal(other);
+	}
+
+	~SmallLimbVector() {
+		release();
+	}
+
+	SmallLimbVector& operator = (const SmallLimbVector& other) {
+		if (this != &other) {
+			if (Traits::propagate_on_container_copy_assignment::value) {
+				release();
+				alloc() = other;
+			}
+			assign(other.begin(), other.end());
+		}
+		return *this;
+	}
+
+	SmallLimbVector& operator = (SmallLimbVector&& other) noexcept {
+		if (this != &other) {
+			if (Traits::propagate_on_container_move_assignment::value) {
+				release();
+				alloc() = std::move(other.alloc());
+				steal(other);
+			}
+			else if (alloc() == other.alloc()) {
+				steal(other);
+			}
+			else {
+				assign(other.begin(), other.end());
+			}
+		}
+		return *this;
+	}
+
+	allocator_type get_allocator() const { return *this; }
+
+	size_t size() const { return len; }
+	size_t capacity() const { return cap; }
+	bool empty() const { return len == 0; }
+	limb_t* data() { return ptr; }
+	const limb_t* data() const { return ptr; }
+	iterator begin() { return ptr; }
+	iterator end() { return ptr + len; }
+	const_iterator begin() const { return ptr; }
+	const_iterator end() const { return ptr + len; }
+	limb_t& operator [] (size_t i) { return ptr[i]; }
+	const limb_t& operator [] (size_t i) const { return ptr[i]; }
+	limb_t& back() { return ptr[len - 1]; }
+	const limb_t& back() const { return ptr[len - 1]; }
+
+	void reserve(size_t n) { grow(n); }
+	void clear() { len = 0; }
+
+	void push_back(limb_t value) {
+		grow(len + 1);
+		ptr[len++] = value;
+	}
+
+	void pop_back() { len--; }
+
+	void resize(size_t n, limb_t value = 0) {
+		grow(n);
+		if (n > len)
+			fill(ptr + len, ptr + n, value);
+		len = n;
+	}
+
+	void assign(size_t n, limb_t value) {
+		len = 0;
+		resize(n, value);
+	}
+
+	void assign(const limb_t* first, const limb_t* last) {
+		size_t n = last - first;
+		len = 0;
+		grow(n);
+		memmove(ptr, first, n * sizeof(limb_t));
+		len = n;
+	}
+
+	iterator insert(iterator pos, size_t n, limb_t value) {
+		size_t at = pos - ptr;
+		grow(len + n);
+		memmove(ptr + at + n, ptr + at, (len - at) * sizeof(limb_t));
+		fill(ptr + at, ptr + at + n, value);
+		len += n;
+		return ptr + at;
+	}
+
+	iterator erase(iterator first, iterator last) {
+		memmove(first, last, (end() - last) * sizeof(limb_t));
+		len -= last - first;
+		return first;
+	}
+
+	void swap(SmallLimbVector& other) {
+		SmallLimbVector tmp(std::move(other));
+		other = std::move(*this);
+		*this = std::move(tmp);
+	}
+
+	friend bool operator == (const SmallLimbVector& a, const SmallLimbVector& b) {
+		return a.len == b.len && equal(a.begin(), a.end(), b.begin());
+	}
+
+	friend bool operator != (const SmallLimbVector& a, const SmallLimbVector& b) {
+		return !(a == b);
+	}
+};
+
+// 8 inline limbs hold values up to 512 bits
+typedef SmallLimbVector<8> LimbVector;
+
+class MontgomeryContext;
+class BarrettContext;
+class Modulus;
+class BigIntView;
+
+enum class ByteOrder { BigEndian, LittleEndian };
+
+// native integers that fit in one limb get the single-limb operator overloads
+template <typename T>
+using EnableIfWord = typename enable_if<is_integral<T>::value && sizeof(T) <= sizeof(limb_t), int>::type;
+
 class BigInt {
+	friend class MontgomeryContext;
+	friend class BarrettContext;
 private:
 	bool isNegative;
-	vector<int> digits;
+	LimbVector digits;
 public:
-	static const int BASE_LEN;
-	static const int BASE;
+	static const int LIMB_BITS;
+	static const int DEC_BASE_LEN;
+	static const limb_t DEC_BASE;
 
 
 	BigInt();
-	BigInt(string s);
-	BigInt(int x);
-	BigInt(vector<int> digits_, bool isNegative_);
+	BigInt(const string& s);
+	template <typename T, EnableIfWord<T> = 0>
+	BigInt(T x) : isNegative(x < 0), digits(1, wordAbs(x)) {}
+	BigInt(vector<limb_t> digits_, bool isNegative_);
+	// takes over the limbs without copying them
+	BigInt(LimbVector&& digits_, bool isNegative_);
+	BigInt(const BigIntView& view);
 	BigInt(const BigInt& bigInt);
+	BigInt(BigInt&& bigInt) noexcept;
+
+	BigInt& operator = (const BigInt& bigInt);
+	BigInt& operator = (BigInt&& bigInt) noexcept;
 
 	void removeLeadingZeros();
 	void clearNumber();
-	BigInt abs();
-	static string formatOutput(int x);
+	BigInt abs() const;
 	static bool isDigit(char ch);
-	bool isZero();
-	bool isPositiveOne();
-	bool isNegativeOne();
-	BigInt sqrt();
-	BigInt pow(BigInt n);
-	BigInt pow(BigInt n, BigInt mod);
-	BigInt reversedBySimpleMod(BigInt mod);
-	BigInt mathMod(BigInt mod);
-	int getLength();
-	vector<int> getDigits();
-
-	friend ostream& operator << (ostream& os, BigInt bigInt);
+	bool isZero() const;
+	bool isPositiveOne() const;
+	bool isNegativeOne() const;
+	BigInt sqrt() const;
+	BigInt iroot(int k) const;
+	bool isPerfectSquare() const;
+	BigInt square() const;
+	BigInt square(const BigInt& mod) const;
+	BigInt pow(const BigInt& n) const;
+	BigInt pow(const BigInt& n, const BigInt& mod) const;
+	BigInt reversedBySimpleMod(const BigInt& mod) const;
+	BigInt mathMod(const BigInt& mod) const;
+	int getLength() const;
+	const LimbVector& getDigits() const;
+
+	// decimal form; the buffer version needs maxStringLength() bytes and
+	// returns the length written, not counting the terminating zero
+	string toString() const;
+	size_t toString(char* buf, size_t size) const;
+	size_t maxStringLength() const;
+
+	// binary import/export of the magnitude, like mpz_import/mpz_export; the
+	// sign is passed separately. toBytes writes byteLength() bytes.
+	static BigInt fromBytes(const uint8_t* data, size_t len, ByteOrder order = ByteOrder::BigEndian, bool isNegative_ = false);
+	size_t byteLength() const;
+	size_t toBytes(uint8_t* out, size_t size, ByteOrder order = ByteOrder::BigEndian) const;
+	vector<uint8_t> toBytes(ByteOrder order = ByteOrder::BigEndian) const;
+
+	// wire format: LEB128 varint of (byte length << 1 | sign), then the
+	// magnitude big-endian; deserialize reports the bytes it used in consumed
+	size_t serializedLength() const;
+	size_t serialize(uint8_t* out, size_t size) const;
+	vector<uint8_t> serialize() const;
+	static BigInt deserialize(const uint8_t* data, size_t size, size_t* consumed = nullptr);
+
+	// base64 of the big-endian magnitude, '-' in front for negative values
+	string toBase64() const;
+	static BigInt fromBase64(const string& text);
+
+	friend ostream& operator << (ostream& os, const BigInt& bigInt);
 	friend istream& operator >> (istream& is, BigInt& bigInt);
 
-	friend bool operator == (BigInt bigInt1, BigInt bigInt2);
-	friend bool operator == (BigInt bigInt1, int int2);
-	friend bool operator == (int int1, BigInt bigInt2);
+	friend bool operator == (const BigInt& bigInt1, const BigInt& bigInt2);
+	template <typename T, EnableIfWord<T> = 0>
+	friend bool operator == (const BigInt& bigInt1, T int2) {
+		return bigInt1.compareWord(wordAbs(int2), int2 < 0) == 0;
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend bool operator == (T int1, const BigInt& bigInt2) {
+		return 0 == bigInt2.compareWord(wordAbs(int1), int1 < 0);
+	}
 
-	friend bool operator != (BigInt bigInt1, BigInt bigInt2);
-	friend bool operator != (BigInt bigInt1, int int2);
-	friend bool operator != (int int1, BigInt bigInt2);
+	friend bool operator != (const BigInt& bigInt1, const BigInt& bigInt2);
+	template <typename T, EnableIfWord<T> = 0>
+	friend bool operator != (const BigInt& bigInt1, T int2) {
+		return bigInt1.compareWord(wordAbs(int2), int2 < 0) != 0;
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend bool operator != (T int1, const BigInt& bigInt2) {
+		return 0 != bigInt2.compareWord(wordAbs(int1), int1 < 0);
+	}
 
-	friend bool operator > (BigInt bigInt1, BigInt bigInt2);
-	friend bool operator > (BigInt bigInt1, int int2);
-	friend bool operator > (int int1, BigInt bigInt2);
+	friend bool operator > (const BigInt& bigInt1, const BigInt& bigInt2);
+	template <typename T, EnableIfWord<T> = 0>
+	friend bool operator > (const BigInt& bigInt1, T int2) {
+		return bigInt1.compareWord(wordAbs(int2), int2 < 0) > 0;
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend bool operator > (T int1, const BigInt& bigInt2) {
+		return 0 > bigInt2.compareWord(wordAbs(int1), int1 < 0);
+	}
 
-	friend bool operator < (BigInt bigInt1, BigInt bigInt2);
-	friend bool operator < (BigInt bigInt1, int int2);
-	friend bool operator < (int int1, BigInt bigInt2);
+	friend bool operator < (const BigInt& bigInt1, const BigInt& bigInt2);
+	template <typename T, EnableIfWord<T> = 0>
+	friend bool operator < (const BigInt& bigInt1, T int2) {
+		return bigInt1.compareWord(wordAbs(int2), int2 < 0) < 0;
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend bool operator < (T int1, const BigInt& bigInt2) {
+		return 0 < bigInt2.compareWord(wordAbs(int1), int1 < 0);
+	}
 
-	friend bool operator >= (BigInt bigInt1, BigInt bigInt2);
-	friend bool operator >= (BigInt bigInt1, int int2);
-	friend bool operator >= (int int1, BigInt bigInt2);
+	friend bool operator >= (const BigInt& bigInt1, const BigInt& bigInt2);
+	template <typename T, EnableIfWord<T> = 0>
+	friend bool operator >= (const BigInt& bigInt1, T int2) {
+		return bigInt1.compareWord(wordAbs(int2), int2 < 0) >= 0;
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend bool operator >= (T int1, const BigInt& bigInt2) {
+		return 0 >= bigInt2.compareWord(wordAbs(int1), int1 < 0);
+	}
 
-	friend bool operator <= (BigInt bigInt1, BigInt bigInt2);
-	friend bool operator <= (BigInt bigInt1, int int2);
-	friend bool operator <= (int int1, BigInt bigInt2);
+	friend bool operator <= (const BigInt& bigInt1, const BigInt& bigInt2);
+	template <typename T, EnableIfWord<T> = 0>
+	friend bool operator <= (const BigInt& bigInt1, T int2) {
+		return bigInt1.compareWord(wordAbs(int2), int2 < 0) <= 0;
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend bool operator <= (T int1, const BigInt& bigInt2) {
+		return 0 <= bigInt2.compareWord(wordAbs(int1), int1 < 0);
+	}
 
-	friend BigInt operator + (BigInt bigInt1, BigInt bigInt2);
-	friend BigInt operator + (BigInt bigInt1, int int2);
-	friend BigInt operator + (int int1, BigInt bigInt2);
+	BigInt& operator += (const BigInt& other);
+	template <typename T, EnableIfWord<T> = 0>
+	BigInt& operator += (T other) {
+		addWord(wordAbs(other), other < 0);
+		return *this;
+	}
+	BigInt& operator -= (const BigInt& other);
+	template <typename T, EnableIfWord<T> = 0>
+	BigInt& operator -= (T other) {
+		addWord(wordAbs(other), !(other < 0));
+		return *this;
+	}
+	BigInt& operator *= (const BigInt& other);
+	template <typename T, EnableIfWord<T> = 0>
+	BigInt& operator *= (T other) {
+		mulWord(wordAbs(other), other < 0);
+		return *this;
+	}
+	BigInt& operator /= (const BigInt& other);
+	template <typename T, EnableIfWord<T> = 0>
+	BigInt& operator /= (T other) {
+		divWord(wordAbs(other), other < 0);
+		return *this;
+	}
+	BigInt& operator %= (const BigInt& other);
+	template <typename T, EnableIfWord<T> = 0>
+	BigInt& operator %= (T other) {
+		digits.assign(1, modWord(wordAbs(other)));
+		clearNumber();
+		return *this;
+	}
+	BigInt& operator <<= (int shift);
+	BigInt& operator >>= (int shift);
+
+	// rvalue left operands are updated in place and moved out
+	friend BigInt operator + (const BigInt& bigInt1, const BigInt& bigInt2);
+	friend BigInt operator + (BigInt&& bigInt1, const BigInt& bigInt2);
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator + (const BigInt& bigInt1, T int2) {
+		BigInt res(bigInt1);
+		res += int2;
+		return res;
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator + (BigInt&& bigInt1, T int2) {
+		bigInt1 += int2;
+		return move(bigInt1);
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator + (T int1, const BigInt& bigInt2) {
+		BigInt res(bigInt2);
+		res += int1;
+		return res;
+	}
 	friend const BigInt operator ++ (BigInt& a, int);
 
-	friend BigInt operator - (BigInt bigInt1, BigInt bigInt2);
-	friend BigInt operator - (BigInt bigInt1, int int2);
-	friend BigInt operator - (int int1, BigInt bigInt2);
-	BigInt operator - ();
+	friend BigInt operator - (const BigInt& bigInt1, const BigInt& bigInt2);
+	friend BigInt operator - (BigInt&& bigInt1, const BigInt& bigInt2);
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator - (const BigInt& bigInt1, T int2) {
+		BigInt res(bigInt1);
+		res -= int2;
+		return res;
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator - (BigInt&& bigInt1, T int2) {
+		bigInt1 -= int2;
+		return move(bigInt1);
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator - (T int1, const BigInt& bigInt2) {
+		BigInt res(-bigInt2);
+		res += int1;
+		return res;
+	}
+	BigInt operator - () const;
+
+	friend BigInt operator * (const BigInt& bigInt1, const BigInt& bigInt2);
+	friend BigInt operator * (BigInt&& bigInt1, const BigInt& bigInt2);
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator * (const BigInt& bigInt1, T int2) {
+		BigInt res(bigInt1);
+		res *= int2;
+		return res;
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator * (BigInt&& bigInt1, T int2) {
+		bigInt1 *= int2;
+		return move(bigInt1);
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator * (T int1, const BigInt& bigInt2) {
+		BigInt res(bigInt2);
+		res *= int1;
+		return res;
+	}
+
+	BigInt div2() const;
+	BigInt mod2() const;
 
-	friend BigInt operator * (BigInt bigInt1, BigInt bigInt2);
-	friend BigInt operator * (BigInt bigInt1, int int2);
-	friend BigInt operator * (int int1, BigInt bigInt2);
+	// bit access on the magnitude, bit 0 least significant
+	int bitLength() const;
+	bool testBit(int i) const;
+	void setBit(int i);
+	void clearBit(int i);
+	// index of the lowest set bit (trailing zero count), -1 for zero
+	int lowestSetBit() const;
+	int popcount() const;
+	string toBinaryString() const;
 
-	BigInt div2();
-	BigInt mod2();
+	friend void divmod(const BigInt& bigInt1, const BigInt& bigInt2, BigInt& quotient, BigInt& remainder);
 
-	friend BigInt operator / (BigInt bigInt1, BigInt bigInt2);
-	friend BigInt operator / (BigInt bigInt1, int int2);
-	friend BigInt operator / (int int1, BigInt bigInt2);
+	friend BigInt operator / (const BigInt& bigInt1, const BigInt& bigInt2);
+	friend BigInt operator / (BigInt&& bigInt1, const BigInt& bigInt2);
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator / (const BigInt& bigInt1, T int2) {
+		BigInt res(bigInt1);
+		res /= int2;
+		return res;
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator / (BigInt&& bigInt1, T int2) {
+		bigInt1 /= int2;
+		return move(bigInt1);
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator / (T int1, const BigInt& bigInt2) {
+		return BigInt(int1) / bigInt2;
+	}
 
-	friend BigInt operator % (BigInt bigInt1, BigInt bigInt2);
-	friend BigInt operator % (BigInt bigInt1, int int2);
-	friend BigInt operator % (int int1, BigInt bigInt2);
+	friend BigInt operator % (const BigInt& bigInt1, const BigInt& bigInt2);
+	friend BigInt operator % (BigInt&& bigInt1, const BigInt& bigInt2);
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator % (const BigInt& bigInt1, T int2) {
+		return fromWord(bigInt1.modWord(wordAbs(int2)), bigInt1.isNegative);
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator % (BigInt&& bigInt1, T int2) {
+		bigInt1 %= int2;
+		return move(bigInt1);
+	}
+	template <typename T, EnableIfWord<T> = 0>
+	friend BigInt operator % (T int1, const BigInt& bigInt2) {
+		return BigInt(int1) % bigInt2;
+	}
 
-	BigInt addBySimpleMod(BigInt other, BigInt mod);
-	BigInt subBySimpleMod(BigInt other, BigInt mod);
-	BigInt mulBySimpleMod(BigInt other, BigInt mod);
-	BigInt divBySimpleMod(BigInt other, BigInt mod);
-	BigInt powBySimpleMod(BigInt n, BigInt mod);
+	// shifts act on the magnitude and keep the sign, so -5 >> 1 == -2 like -5 / 2
+	friend BigInt operator << (const BigInt& bigInt, int shift);
+	friend BigInt operator << (BigInt&& bigInt, int shift);
+	friend BigInt operator >> (const BigInt& bigInt, int shift);
+	friend BigInt operator >> (BigInt&& bigInt, int shift);
 
+	// modular arithmetic with results in [0, mod); the Modulus overloads reuse
+	// the reduction data of a fixed modulus across calls
+	BigInt addBySimpleMod(const BigInt& other, const BigInt& mod) const;
+	BigInt subBySimpleMod(const BigInt& other, const BigInt& mod) const;
+	BigInt mulBySimpleMod(const BigInt& other, const BigInt& mod) const;
+	BigInt divBySimpleMod(const BigInt& other, const BigInt& mod) const;
+	BigInt powBySimpleMod(const BigInt& n, const BigInt& mod) const;
+	BigInt addBySimpleMod(const BigInt& other, Modulus& mod) const;
+	BigInt subBySimpleMod(const BigInt& other, Modulus& mod) const;
+	BigInt mulBySimpleMod(const BigInt& other, Modulus& mod) const;
+	BigInt divBySimpleMod(const BigInt& other, Modulus& mod) const;
+	BigInt powBySimpleMod(const BigInt& n, Modulus& mod) const;
+
+private:
+	void addMagnitude(const LimbVector& other, bool otherNegative);
+	static BigInt parseDecimal(const char* s, int len);
+	static void writeDecimal(const BigInt& x, int k, char* end);
+
+	// magnitude of a native integer, also right for the most negative value
+	template <typename T>
+	static limb_t wordAbs(T x) {
+		return x < 0 ? (limb_t)0 - (limb_t)x : (limb_t)x;
+	}
+	static BigInt fromWord(limb_t mag, bool negative);
+	int compareWord(limb_t mag, bool negative) const;
+	void addWord(limb_t mag, bool negative);
+	void mulWord(limb_t mag, bool negative);
+	void divWord(limb_t mag, bool negative);
+	limb_t modWord(limb_t mag) const;
+};
+
+// Read-only view of little-endian limbs owned elsewhere, e.g. a mapped file or
+// a received buffer; nothing is copied until it is turned into a BigInt
+class BigIntView {
+private:
+	const limb_t* limbs;
+	size_t count;
+	bool negative;
+public:
+	BigIntView(const limb_t* limbs_, size_t count_, bool isNegative_ = false);
+	BigIntView(const BigInt& bigInt);
+	// bytes must be 8-byte aligned little-endian limbs on a little-endian host
+	static BigIntView fromBytes(const uint8_t* data, size_t len, bool isNegative_ = false);
+
+	const limb_t* data() const;
+	size_t size() const;
+	bool isNegative() const;
+	size_t byteLength() const;
+	size_t toBytes(uint8_t* out, size_t size, ByteOrder order = ByteOrder::BigEndian) const;
+	size_t serializedLength() const;
+	size_t serialize(uint8_t* out, size_t size) const;
+	BigInt toBigInt() const;
+};
+
+// Montgomery arithmetic modulo a fixed odd m > 1, R = 2^(64 * limbs of m).
+// Values passed to mul/square are in the Montgomery domain (a * R mod m).
+class MontgomeryContext {
+private:
+	int n;
+	LimbVector mod;
+	LimbVector r2;
+	limb_t mInv;
+	vector<limb_t> scratch;
+	vector<limb_t> wide;
+	// padded operands and result of mul/square, kept so calls don't allocate
+	vector<limb_t> lhs;
+	vector<limb_t> rhs;
+	vector<limb_t> prod;
+
+	void montMul(const limb_t* a, const limb_t* b, limb_t* res);
+	void montSqr(const limb_t* a, limb_t* res);
+	void montReduce(limb_t* t, limb_t* res);
+	void finalSubtract(limb_t* t, limb_t* res);
+	void padded(const BigInt& a, vector<limb_t>& out);
+	BigInt fromLimbs(const limb_t* res);
+	void storeLimbs(const limb_t* res, BigInt& out);
+public:
+	MontgomeryContext(const BigInt& mod_);
+	// rebinds the context to another odd modulus, reusing its buffers
+	void reset(const BigInt& mod_);
+
+	BigInt getModulus() const;
+	BigInt toMontgomery(const BigInt& a);
+	BigInt fromMontgomery(const BigInt& a);
+	BigInt one();
+	BigInt mul(const BigInt& a, const BigInt& b);
+	BigInt square(const BigInt& a);
+	// acc = acc * b and acc = acc^2, reusing the limbs of acc
+	void mulInPlace(BigInt& acc, const BigInt& b);
+	void squareInPlace(BigInt& acc);
+	BigInt modexp(const BigInt& base, const BigInt& n);
+	// base^n for an ordinary base, returned in the Montgomery domain
+	BigInt modexpToMontgomery(const BigInt& base, const BigInt& n);
+};
+
+// Barrett reduction modulo a fixed m > 0 (HAC 14.42) with mu = floor(b^2n / m),
+// b = 2^64 and n the limbs of m. Works for any m, including even ones, and
+// values stay ordinary residues; inputs below b^2n (a product of two residues)
+// are reduced with two half products instead of a long division.
+class BarrettContext {
+private:
+	int n;
+	LimbVector mod;
+	vector<limb_t> mu;
+	vector<limb_t> scratch;
+	vector<limb_t> wide;
+
+	void reduceLimbs(const limb_t* x, limb_t* res);
+	void mulLimbsMod(const limb_t* a, const limb_t* b, limb_t* res);
+	void sqrLimbsMod(const limb_t* a, limb_t* res);
+	BigInt fromLimbs(const limb_t* res);
+public:
+	BarrettContext(const BigInt& mod_);
+
+	BigInt getModulus() const;
+	BigInt reduce(const BigInt& x);
+	BigInt mul(const BigInt& a, const BigInt& b);
+	BigInt square(const BigInt& a);
+	BigInt modexp(const BigInt& base, const BigInt& n);
+};
+
+// A fixed modulus m >= 1 for chains of modular operations. Reduction data is
+// built on first use and kept. Operands of add/sub/mul/square/div/pow must be
+// residues in [0, m), and so are the results; reduce() brings any value there.
+class Modulus {
+private:
+	BigInt m;
+	unique_ptr<MontgomeryContext> mont;
+	unique_ptr<BarrettContext> barr;
+
+	bool useMontgomery() const;
+	bool useBarrett() const;
+	MontgomeryContext& montgomery();
+	BarrettContext& barrett();
+public:
+	explicit Modulus(const BigInt& m_);
+
+	const BigInt& value() const;
+	BigInt reduce(const BigInt& a);
+	BigInt add(const BigInt& a, const BigInt& b) const;
+	BigInt sub(const BigInt& a, const BigInt& b) const;
+	BigInt mul(const BigInt& a, const BigInt& b);
+	BigInt square(const BigInt& a);
+	BigInt inverse(const BigInt& a) const;
+	BigInt div(const BigInt& a, const BigInt& b);
+	// negative n raises the inverse
+	BigInt pow(const BigInt& a, const BigInt& n);
+};
+
+BigInt karatsuba(const BigInt& a, const BigInt& b);
+BigInt gcd(const BigInt& a, const BigInt& b);
+BigInt gcd(int a, const BigInt& b);
+// returns g = gcd(a, b) >= 0 and sets s, t with a * s + b * t = g
+BigInt extendedGcd(const BigInt& a, const BigInt& b, BigInt& s, BigInt& t);
+// Kronecker symbol (a | n); the Jacobi symbol when n is odd and positive
+int jacobi(const BigInt& a, const BigInt& n);
+
+// ChaCha20 keystream as a random source. local() is the calling thread's own
+// generator, keyed from std::random_device; the seeded constructors give
+// reproducible streams (ChaChaRandom::local() = ChaChaRandom(seed)).
+class ChaChaRandom {
+private:
+	uint32_t state[16];
+	alignas(32) uint8_t buffer[512];
+	size_t pos;
+
+	void setKey(const uint8_t* key, uint64_t stream);
+	void advance();
+public:
+	ChaChaRandom();
+	explicit ChaChaRandom(uint64_t seed);
+	// 32-byte key, stream selects one of 2^64 independent keystreams
+	ChaChaRandom(const uint8_t* key, uint64_t stream);
+	static ChaChaRandom& local();
+
+	void fill(uint8_t* out, size_t len);
+	void fill(limb_t* out, size_t count);
+	limb_t next();
+	// uniform in [0, bound), throws "ValueError" for bound <= 0
+	BigInt below(const BigInt& bound);
+};
+
+// uniform in [0, bound) from the thread's generator
+BigInt randBigInt(const BigInt& bound);
+
+// true when a prime p <= bound other than |n| itself divides n; bound <= 2^16
+bool hasSmallFactor(const BigInt& n, int bound);
+
+// probable prime tests; MillerRabinTest runs k rounds with random bases
+bool MillerRabinTest(const BigInt& n, int k);
+// MillerRabinTest for every candidate, spread over all cores; results in input order
+vector<bool> MillerRabinTestBatch(const vector<BigInt>& candidates, int k);
+// the k rounds for one large n run concurrently, the first witness cancels the rest
+bool MillerRabinTestParallel(const BigInt& n, int k);
+bool MillerRabinTest_Base(const BigInt& n, int base);
+bool LucasSelfridgeTest(const BigInt& n);
+bool BailliePSWTest(const BigInt& n);
+// random prime of exactly bits bits (2^(bits-1) <= p < 2^bits)
+BigInt generatePrime(int bits);
+
+// prime factors of |n| in ascending order, with multiplicity; throws "ValueError" for 0
+vector<BigInt> factorize(const BigInt& n);
+// a nontrivial factor of odd composite n by Pollard-Brent rho on x^2 + c, 0 when
+// maxSteps run out first
+BigInt pollardBrent(const BigInt& n, const BigInt& c, long maxSteps);
+// a nontrivial factor of odd composite n from ECM stage 1 on the given number of
+// random curves (at least one), spread over all cores; 0 when none of them finds one
+BigInt ecmStage1(const BigInt& n, limb_t b1, int curves);
+
+// base64 (RFC 4648, padded); vectorized with SSSE3/AVX2 when the CPU has them.
+// Decoding throws "ValueError" on characters outside the alphabet or bad padding.
+size_t base64EncodedLength(size_t len);
+size_t base64Encode(const uint8_t* data, size_t len, char* out);
+string base64Encode(const uint8_t* data, size_t len);
+size_t base64DecodedMaxLength(size_t len);
+size_t base64Decode(const char* text, size_t len, uint8_t* out);
+vector<uint8_t> base64Decode(const string& text);
+
+// streaming versions for input that arrives in pieces; update appends to out
+class Base64Encoder {
+private:
+	uint8_t pending[3];
+	int pendingLen;
+public:
+	Base64Encoder();
+	void update(const uint8_t* data, size_t len, string& out);
+	void finish(string& out);
+};
+
+class Base64Decoder {
+private:
+	char pending[4];
+	int pendingLen;
+	bool finished;
+
+	void flush(const char* text, size_t len, vector<uint8_t>& out);
+public:
+	Base64Decoder();
+	void update(const char* text, size_t len, vector<uint8_t>& out);
+	void finish(vector<uint8_t>& out);
 };
 
-BigInt karatsuba(BigInt a, BigInt b);
\ No newline at end of file
+// whole streams in fixed-size blocks, for data larger than memory
+void base64Encode(istream& in, ostream& out);
+void base64Decode(istream& in, ostream& out);
\ No newline at end of file